@@ -57,67 +57,45 @@ struct connect3dBoard {
      * 
     */
 
-    // returns the player that won the game, otherwise NONE. Not optimized.
-    player checkWin() const {
-        auto check = [&](int i1, int i2, int i3, int i4) {
-            if (board[i1] != player::NONE &&
-                board[i1] == board[i2] &&
-                board[i2] == board[i3] &&
-                board[i3] == board[i4]) {
-                return board[i1];
-            }
-            return player::NONE;
-        };
-
-        // 1. Stacks (Vertical)
-        for (int r = 0; r < 4; ++r) {
-            for (int c = 0; c < 4; ++c) {
-                int i = r * 4 + c;
-                if (auto p = check(i, i + 16, i + 32, i + 48); p != player::NONE) return p;
-            }
-        }
-
-        // 2. Rows (Horizontal along c)
-        for (int d = 0; d < 4; ++d) {
-            for (int r = 0; r < 4; ++r) {
-                int i = d * 16 + r * 4;
-                if (auto p = check(i, i + 1, i + 2, i + 3); p != player::NONE) return p;
-            }
-        }
+    // bitboard of a player's pieces, bit i set for board[i]
+    uint64_t bitboard(player p) const {
+        uint64_t b = 0;
+        for (int i = 0; i < 64; ++i) b |= (uint64_t)(board[i] == p) << i;
+        return b;
+    }
 
-        // 3. Columns (Horizontal along r)
-        for (int d = 0; d < 4; ++d) {
-            for (int c = 0; c < 4; ++c) {
-                int i = d * 16 + c;
-                if (auto p = check(i, i + 4, i + 8, i + 12); p != player::NONE) return p;
+    // A line is 4 cells with a fixed index step. For each of the 13 directions, the step and the cells a line can start from.
+    // Directions are oriented so the step is positive.
+    static constexpr std::array<std::pair<int, uint64_t>, 13> lineDirections = []() {
+        std::array<std::pair<int, uint64_t>, 13> dirs{};
+        int n = 0;
+        auto add = [&](int dc, int dr, int dz) {
+            uint64_t starts = 0;
+            for (int z = 0; z < 4; ++z) for (int r = 0; r < 4; ++r) for (int c = 0; c < 4; ++c) {
+                int ec = c + 3 * dc, er = r + 3 * dr, ez = z + 3 * dz;
+                if (ec >= 0 && ec < 4 && er >= 0 && er < 4 && ez >= 0 && ez < 4) starts |= 1ULL << (z * 16 + r * 4 + c);
             }
+            dirs[n++] = {dc + 4 * dr + 16 * dz, starts};
+        };
+        add(1, 0, 0);
+        for (int dc = -1; dc <= 1; ++dc) add(dc, 1, 0);
+        for (int dr = -1; dr <= 1; ++dr) for (int dc = -1; dc <= 1; ++dc) add(dc, dr, 1);
+        return dirs;
+    }();
+
+    // true if the bitboard has 4 in a line: shifts the board along each direction and ANDs the copies
+    static bool hasLine(uint64_t b) {
+        uint64_t found = 0;
+        for (const auto& [step, starts] : lineDirections) {
+            found |= b & (b >> step) & (b >> (2 * step)) & (b >> (3 * step)) & starts;
         }
+        return found != 0;
+    }
 
-        // 4. Planar Diagonals
-        for (int d = 0; d < 4; ++d) {
-            int i = d * 16;
-            if (auto p = check(i, i + 5, i + 10, i + 15); p != player::NONE) return p;
-            if (auto p = check(i + 3, i + 6, i + 9, i + 12); p != player::NONE) return p;
-        }
-
-        // 5. Stairs (Vertical Diagonals)
-        for (int r = 0; r < 4; ++r) {
-            int i = r * 4;
-            if (auto p = check(i, i + 17, i + 34, i + 51); p != player::NONE) return p;
-            if (auto p = check(i + 3, i + 18, i + 33, i + 48); p != player::NONE) return p;
-        }
-        for (int c = 0; c < 4; ++c) {
-            int i = c;
-            if (auto p = check(i, i + 20, i + 40, i + 60); p != player::NONE) return p;
-            if (auto p = check(i + 12, i + 24, i + 36, i + 48); p != player::NONE) return p;
-        }
-
-        // 6. Space Diagonals
-        if (auto p = check(0, 21, 42, 63); p != player::NONE) return p;
-        if (auto p = check(3, 22, 41, 60); p != player::NONE) return p;
-        if (auto p = check(12, 25, 38, 51); p != player::NONE) return p;
-        if (auto p = check(15, 26, 37, 48); p != player::NONE) return p;
-
+    // returns the player that won the game, otherwise NONE.
+    player checkWin() const {
+        if (hasLine(bitboard(player::A))) return player::A;
+        if (hasLine(bitboard(player::B))) return player::B;
         return player::NONE;
     }
 
@@ -0,0 +1,627 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <functional>
+
+#include "3d-connect4-board.hpp"
+#include "minimax_ai_b5_v2.hpp"
+
+// Search benchmarks for the b5 engine. Not part of the game, build with `make bench`.
+// Usage: ./benchmark [section], runs every section if none is given.
+
+// Fixed set of positions to benchmark on. They are reached by playing seeded random moves from the
+// empty board, so every run searches the same positions. Positions where a shallow search already
+// finds a forced win are skipped, since they don't reflect the quiet positions most time is spent on.
+std::vector<connect3dBoard> benchPositions() {
+    std::vector<connect3dBoard> positions;
+    std::mt19937 rng(12345);
+    const int plies[] = {4, 8, 12, 16, 20, 24, 28, 32};
+
+    for (int n : plies) {
+        while (true) {
+            connect3dBoard board;
+            for (int i = 0; i < n; ++i) {
+                auto moves = board.findMoves();
+                board.makeMove(moves[rng() % moves.size()]);
+            }
+            if (board.checkWin() != player::NONE) continue;
+
+            b5_v2::connect3dBoardFast fast(board);
+            mm5::stat_t stats;
+            mm5::transpositionTable noTT;
+            int16_t score = mm5::minimax(fast, board.getPlayerTurn(), 0, 4, (b5_v2::connect3dMoveFast*)nullptr, stats, noTT);
+            if (std::abs(score) < 1000) {
+                positions.push_back(board);
+                break;
+            }
+        }
+    }
+    return positions;
+}
+
+// milliseconds taken by f
+double timeMs(const std::function<void()>& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Lazy SMP: fixed depth move latency and node counts per thread, as threads are added.
+void benchLazySmp() {
+    std::cout << "== Lazy SMP, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    double baseline = 0;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double total = 0;
+        std::vector<uint64_t> nodes(threads, 0);
+
+        for (const auto& pos : positions) {
+            b5_v2::connect3dBoardFast board(pos);
+            mm5::transpositionTable tt(1024 * 1024 * 4);
+            mm5::stat_t stats;
+            b5_v2::connect3dMoveFast move;
+            total += timeMs([&]() { mm5::lazySmp(board, pos.getPlayerTurn(), 7, 0, false, &move, stats, tt, threads); });
+            for (unsigned t = 0; t < threads; ++t) nodes[t] += stats.nodesPerThread[t];
+        }
+
+        if (threads == 1) baseline = total;
+        std::cout << threads << " threads: " << total / positions.size() << " ms/move, speedup "
+                  << baseline / total << ", nodes per thread:";
+        for (auto n : nodes) std::cout << " " << n;
+        std::cout << std::endl;
+    }
+}
+
+// Young brothers wait: speedup and efficiency per thread count at depth 7, without a transposition table.
+void benchYbwc() {
+    std::cout << "== Young brothers wait, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    double baseline = 0;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double total = 0;
+        uint64_t nodes = 0;
+
+        for (const auto& pos : positions) {
+            b5_v2::connect3dBoardFast board(pos);
+            mm5::stat_t stats;
+            b5_v2::connect3dMoveFast move;
+            total += timeMs([&]() { mm5::ybwc(board, pos.getPlayerTurn(), 7, &move, stats, threads); });
+            nodes += stats.nodesExplored;
+        }
+
+        if (threads == 1) baseline = total;
+        std::cout << threads << " threads: " << total / positions.size() << " ms/move, speedup " << baseline / total
+                  << ", efficiency " << baseline / total / threads << ", nodes " << nodes << std::endl;
+    }
+}
+
+// Search one position to depth with a fresh 4MB transposition table. Returns the time taken in ms.
+double searchPosition(const connect3dBoard& pos, int depth, mm5::stat_t& stats, const mm5::searchOptions& options, int16_t* scoreRet = nullptr) {
+    b5_v2::connect3dBoardFast board(pos);
+    mm5::transpositionTable tt(1024 * 1024 * 4);
+    b5_v2::connect3dMoveFast move;
+    int16_t score = 0;
+    double ms = timeMs([&]() { score = mm5::minimax(board, pos.getPlayerTurn(), 0, depth, &move, stats, tt, nullptr, options); });
+    if (scoreRet) *scoreRet = score;
+    return ms;
+}
+
+// Searches positions at each depth with plain and then variant options, printing the time per move and
+// nodes under plainLabel and variantLabel. extraStats, if given, prints the rest of each line from the stats.
+void compareOptions(const std::vector<connect3dBoard>& positions, const char* plainLabel, const char* variantLabel,
+    std::initializer_list<int> depths, const mm5::searchOptions& plain, const mm5::searchOptions& variant,
+    const std::function<void(const mm5::stat_t&)>& extraStats = nullptr) {
+    for (int depth : depths) {
+        for (const auto* options : {&plain, &variant}) {
+            mm5::stat_t stats;
+            double ms = 0;
+            for (const auto& pos : positions) ms += searchPosition(pos, depth, stats, *options);
+            std::cout << (options == &plain ? plainLabel : variantLabel) << "depth " << depth << ": " << ms / positions.size() << " ms/move, "
+                      << stats.nodesExplored << " nodes";
+            if (extraStats) extraStats(stats);
+            std::cout << std::endl;
+        }
+    }
+}
+
+// Options for benchmarks that check two searches return the same score. Late move reductions make
+// the score depend on the window, so they are off.
+mm5::searchOptions windowExactOptions() {
+    mm5::searchOptions options;
+    options.lmr = false;
+    return options;
+}
+
+// Principal variation search against plain full window alpha-beta, at the same depth.
+// Move order is shuffled per run, so each position is searched a few times.
+void benchPvs() {
+    std::cout << "== PVS against full window alpha-beta, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions full = windowExactOptions(), pvs = windowExactOptions();
+    full.pvs = false;
+
+    mm5::stat_t fullStats, pvsStats;
+    double fullMs = 0, pvsMs = 0;
+    for (int run = 0; run < 3; ++run) {
+        for (const auto& pos : positions) {
+            int16_t a, b;
+            fullMs += searchPosition(pos, 7, fullStats, full, &a);
+            pvsMs += searchPosition(pos, 7, pvsStats, pvs, &b);
+            if (a != b) std::cout << "score mismatch: " << a << " vs " << b << std::endl;
+        }
+    }
+    std::cout << "full window: " << fullStats.nodesExplored << " nodes, " << fullMs << " ms" << std::endl;
+    std::cout << "pvs:         " << pvsStats.nodesExplored << " nodes, " << pvsMs << " ms, "
+              << pvsStats.pvsResearches << " re-searches" << std::endl;
+}
+
+// Aspiration windows against a full root window at depth 7. The expected score for each position is
+// that of a depth 5 search, standing in for the previous move's score.
+void benchAspiration() {
+    std::cout << "== Aspiration windows against full root window, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions options = windowExactOptions();
+
+    mm5::stat_t fullStats, aspStats;
+    double fullMs = 0, aspMs = 0;
+    for (int run = 0; run < 3; ++run) {
+        for (const auto& pos : positions) {
+            mm5::stat_t predictStats;
+            int16_t expected;
+            searchPosition(pos, 5, predictStats, options, &expected);
+
+            int16_t a, b;
+            fullMs += searchPosition(pos, 7, fullStats, options, &a);
+
+            b5_v2::connect3dBoardFast board(pos);
+            mm5::transpositionTable tt(1024 * 1024 * 4);
+            b5_v2::connect3dMoveFast move;
+            aspMs += timeMs([&]() { b = mm5::aspirationSearch(board, pos.getPlayerTurn(), 7, expected, &move, aspStats, tt, nullptr, options); });
+            if (a != b) std::cout << "score mismatch: " << a << " vs " << b << std::endl;
+        }
+    }
+    std::cout << "full window: " << fullStats.nodesExplored << " nodes, " << fullMs << " ms" << std::endl;
+    std::cout << "aspiration:  " << aspStats.nodesExplored << " nodes, " << aspMs << " ms, "
+              << aspStats.aspirationFailLows << " fail lows, " << aspStats.aspirationFailHighs << " fail highs" << std::endl;
+}
+
+// Killer and history move ordering against heuristic ordering alone, at depth 7.
+void benchOrdering() {
+    std::cout << "== Killer and history ordering, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, ordered;
+    plain.killersAndHistory = false;
+
+    for (const auto* options : {&plain, &ordered}) {
+        mm5::stat_t stats;
+        double ms = 0;
+        for (int run = 0; run < 3; ++run) {
+            for (const auto& pos : positions) ms += searchPosition(pos, 7, stats, *options);
+        }
+        std::cout << (options == &plain ? "heuristic only:    " : "killers + history: ") << stats.nodesExplored << " nodes, " << ms << " ms, "
+                  << "first move cutoff rate " << (double)stats.firstMoveCutoffs / stats.cutoffs << std::endl;
+        std::cout << "    cutoffs by stage: TT move " << stats.stageCutoffs[mm5::STAGE_TT_MOVE] << ", wins and blocks " << stats.stageCutoffs[mm5::STAGE_FORCING]
+                  << ", killers " << stats.stageCutoffs[mm5::STAGE_KILLERS] << ", quiet " << stats.stageCutoffs[mm5::STAGE_QUIET] << std::endl;
+    }
+}
+
+// MTD(f) against alpha-beta at depth 7, both guessing the score of a depth 5 search.
+void benchMtdf() {
+    std::cout << "== MTD(f) against alpha-beta, depth 7 ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions alphaBeta = windowExactOptions(), mtdf = windowExactOptions();
+    mtdf.driver = mm5::MTDF;
+
+    mm5::stat_t abStats, mtdfStats;
+    double abMs = 0, mtdfMs = 0;
+    for (int run = 0; run < 3; ++run) {
+        for (const auto& pos : positions) {
+            mm5::stat_t predictStats;
+            int16_t expected;
+            searchPosition(pos, 5, predictStats, alphaBeta, &expected);
+
+            int16_t scores[2];
+            for (int d = 0; d < 2; ++d) {
+                b5_v2::connect3dBoardFast board(pos);
+                mm5::transpositionTable tt(1024 * 1024 * 4);
+                b5_v2::connect3dMoveFast move;
+                double ms = timeMs([&]() {
+                    scores[d] = mm5::searchRoot(board, pos.getPlayerTurn(), 7, expected, true, &move, d ? mtdfStats : abStats, tt,
+                        nullptr, d ? mtdf : alphaBeta);
+                });
+                (d ? mtdfMs : abMs) += ms;
+            }
+            if (scores[0] != scores[1]) std::cout << "score mismatch: " << scores[0] << " vs " << scores[1] << std::endl;
+        }
+    }
+    std::cout << "alpha-beta: " << abStats.nodesExplored << " nodes, " << abMs << " ms" << std::endl;
+    std::cout << "MTD(f):     " << mtdfStats.nodesExplored << " nodes, " << mtdfMs << " ms, "
+              << mtdfStats.mtdfPasses << " passes (" << (double)mtdfStats.mtdfPasses / (3 * positions.size()) << " per search)" << std::endl;
+}
+
+// Late move reductions: time and nodes at depth 7 without them, against depths 7 to 10 with them.
+void benchLmr() {
+    std::cout << "== Late move reductions ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, lmr;
+    plain.lmr = false;
+
+    auto run = [&](const char* name, int depth, const mm5::searchOptions& options) {
+        mm5::stat_t stats;
+        double ms = 0;
+        for (const auto& pos : positions) ms += searchPosition(pos, depth, stats, options);
+        std::cout << name << " depth " << depth << ": " << ms / positions.size() << " ms/move, " << stats.nodesExplored << " nodes, "
+                  << stats.lmrReductions << " reductions, " << stats.lmrResearches << " re-searches" << std::endl;
+    };
+    run("no lmr", 7, plain);
+    for (int depth = 7; depth <= 10; ++depth) run("lmr   ", depth, lmr);
+}
+
+// Quiescence search of forcing moves at the depth limit, against scoring the horizon by heuristic alone.
+void benchQuiescence() {
+    std::cout << "== Quiescence search ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, quiescence;
+    plain.quiescenceDepth = 0;
+
+    compareOptions(positions, "heuristic  ", "quiescence ", {6, 8}, plain, quiescence, [](const mm5::stat_t& stats) {
+        std::cout << ", " << stats.quiescenceNodes << " forced blocks";
+    });
+}
+
+// Forced move pruning, searching only the win or block when there is one, against the full move list.
+void benchForced() {
+    std::cout << "== Forced move pruning ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, forced;
+    plain.forcedMoves = false;
+
+    compareOptions(positions, "full move list ", "forced moves   ", {6, 8}, plain, forced, [](const mm5::stat_t& stats) {
+        std::cout << ", " << stats.forcedWins << " wins, " << stats.forcedBlocks << " blocks, " << stats.doubleThreats << " double threats";
+    });
+}
+
+// Frontier node fusion, scoring the leaves of depth 1 nodes in place, against searching each leaf.
+void benchFrontier() {
+    std::cout << "== Frontier node fusion ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, fused;
+    plain.frontierFusion = false;
+
+    compareOptions(positions, "searched leaves ", "fused leaves    ", {6, 8, 10}, plain, fused, [](const mm5::stat_t& stats) {
+        std::cout << ", " << stats.frontierLeaves << " scored in place, " << stats.ttProbes << " TT probes";
+    });
+}
+
+// Searching the transposition table's best move first, with iterative deepening to depth 8
+// so every iteration finds the moves of the one before it.
+void benchTTMove() {
+    std::cout << "== TT move first, iterative deepening to depth 8 ==" << std::endl;
+    auto positions = benchPositions();
+    mm5::searchOptions plain, ttFirst;
+    plain.ttMoveFirst = false;
+
+    for (const auto* options : {&plain, &ttFirst}) {
+        mm5::stat_t stats;
+        double ms = 0;
+        for (const auto& pos : positions) {
+            b5_v2::connect3dBoardFast board(pos);
+            mm5::transpositionTable tt(1024 * 1024 * 4);
+            b5_v2::connect3dMoveFast move;
+            ms += timeMs([&]() { mm5::iterativeDeepening(board, pos.getPlayerTurn(), 8, &move, stats, tt, nullptr, *options); });
+        }
+        std::cout << (options == &plain ? "heuristic first: " : "TT move first:   ") << stats.nodesExplored << " nodes, " << ms / positions.size() << " ms/move, "
+                  << "first move cutoff rate " << (double)stats.firstMoveCutoffs / stats.cutoffs << std::endl;
+    }
+}
+
+// Transposition table hits over a self-play game between two b5 v2 engines, each keeping its table
+// across moves. Hits are split into entries from the current search and stale ones from earlier moves.
+void benchTTAging() {
+    std::cout << "== Transposition table hits over a game ==" << std::endl;
+    connect3dBoard board;
+    MinimaxAI_b5_v2 players[2];
+    mm5::stat_t total;
+
+    for (int move = 0; board.checkWin() == player::NONE && !board.findMoves().empty(); ++move) {
+        MinimaxAI_b5_v2& ai = players[board.getPlayerTurn() == player::A ? 0 : 1];
+        b5_v2::connect3dBoardFast fast(board);
+        mm5::stat_t stats;
+        b5_v2::connect3dMoveFast bestMove;
+        ai.tt.newSearch();
+        mm5::minimax(fast, board.getPlayerTurn(), 0, ai.maxDepth, &bestMove, stats, ai.tt, nullptr, ai.options);
+
+        std::cout << "move " << move << ": " << stats.nodesExplored << " nodes, " << stats.ttHitsFresh << " fresh hits, "
+                  << stats.ttHitsStale << " stale hits, " << stats.hashCollisions << " collisions" << std::endl;
+        board.makeMove(bestMove);
+
+        total.nodesExplored += stats.nodesExplored;
+        total.ttProbes += stats.ttProbes;
+        total.ttHitsFresh += stats.ttHitsFresh;
+        total.ttHitsStale += stats.ttHitsStale;
+        total.hashCollisions += stats.hashCollisions;
+    }
+
+    uint64_t hits = total.ttHitsFresh + total.ttHitsStale;
+    std::cout << "game: " << total.nodesExplored << " nodes, hit rate " << (double)hits / total.ttProbes << " (" << (double)hits / total.nodesExplored
+              << " per node), " << total.hashCollisions << " collisions (" << (double)total.hashCollisions / total.nodesExplored << " per node)" << std::endl;
+}
+
+// Plays a game with both tables keeping compressed positions, counting key matches that are another position.
+void benchTTKeys() {
+    std::cout << "== Transposition table key false positives ==" << std::endl;
+    connect3dBoard board;
+    MinimaxAI_b5_v2 players[2];
+    for (MinimaxAI_b5_v2& ai : players) ai.tt.enableVerification();
+    mm5::stat_t total;
+
+    while (board.checkWin() == player::NONE && !board.findMoves().empty()) {
+        MinimaxAI_b5_v2& ai = players[board.getPlayerTurn() == player::A ? 0 : 1];
+        b5_v2::connect3dBoardFast fast(board);
+        b5_v2::connect3dMoveFast bestMove;
+        ai.tt.newSearch();
+        mm5::minimax(fast, board.getPlayerTurn(), 0, ai.maxDepth, &bestMove, total, ai.tt, nullptr, ai.options);
+        board.makeMove(bestMove);
+    }
+
+    uint64_t hits = total.ttHitsFresh + total.ttHitsStale;
+    std::cout << "game: " << total.ttProbes << " probes, " << hits << " hits, " << total.ttFalsePositives << " false positives ("
+              << (double)total.ttFalsePositives / total.ttProbes << " per probe)" << std::endl;
+}
+
+// compressPosition as it was before the bitboard symmetries: 8 column permutations, each packed and compared
+std::array<uint8_t, 10> compressPositionPermuted(const b5_v2::connect3dBoardFast& board) {
+    std::array<uint8_t, 16> vals;
+    for (int i = 0; i < 16; i++) {
+        uint8_t val = 0;
+        for (int z = 0; z < 4; z++) {
+            if (board.boardA & (1ULL << (i + 16 * z))) val += 1;
+            else if (board.boardB & (1ULL << (i + 16 * z))) val += 16 >> z;
+        }
+        vals[i] = val;
+    }
+
+    std::array<uint8_t, 10> minCompressed;
+    minCompressed.fill(255);
+    const auto& symTable = b5_v2::connect3dBoardFast::getSymmetryTable();
+    for (int s = 0; s < 8; s++) {
+        std::array<uint8_t, 16> permutedVals;
+        for (int src = 0; src < 16; ++src) permutedVals[symTable[s][src]] = vals[src];
+
+        std::array<uint8_t, 10> currentCompressed;
+        currentCompressed.fill(0);
+        int bitOffset = 0;
+        for (int i = 0; i < 16; i++) {
+            uint8_t v = permutedVals[i];
+            currentCompressed[bitOffset / 8] |= (v << (bitOffset % 8));
+            if (bitOffset % 8 > 3) currentCompressed[bitOffset / 8 + 1] |= (v >> (8 - bitOffset % 8));
+            bitOffset += 5;
+        }
+        if (currentCompressed < minCompressed) minCompressed = currentCompressed;
+    }
+    return minCompressed;
+}
+
+// compressPosition: bitboard symmetries against the column permutation loop, and a check that
+// every symmetry of a position compresses to the same key.
+void benchCanonical() {
+    std::cout << "== Canonical position ==" << std::endl;
+    std::vector<b5_v2::connect3dBoardFast> boards;
+    std::mt19937 rng(12345);
+    while (boards.size() < 10000) {
+        connect3dBoard board;
+        while (board.checkWin() == player::NONE && !board.findMoves().empty()) {
+            boards.emplace_back(board);
+            auto moves = board.findMoves();
+            board.makeMove(moves[rng() % moves.size()]);
+        }
+    }
+
+    int mismatches = 0;
+    for (const auto& board : boards) {
+        auto key = board.compressPosition();
+        auto oldKey = compressPositionPermuted(board);
+        for (int s = 1; s < 8; s++) {
+            b5_v2::connect3dBoardFast sym = board;
+            sym.boardA = b5_v2::connect3dBoardFast::applySymmetry(board.boardA, s);
+            sym.boardB = b5_v2::connect3dBoardFast::applySymmetry(board.boardB, s);
+            if (sym.compressPosition() != key || compressPositionPermuted(sym) != oldKey) mismatches++;
+        }
+    }
+    std::cout << boards.size() << " positions, " << mismatches << " symmetries with a different key" << std::endl;
+
+    const int reps = 100;
+    uint64_t sink = 0;
+    double permutedMs = timeMs([&] {
+        for (int r = 0; r < reps; r++) for (const auto& board : boards) sink += compressPositionPermuted(board)[r % 10];
+    });
+    double bitboardMs = timeMs([&] {
+        for (int r = 0; r < reps; r++) for (const auto& board : boards) sink += board.compressPosition()[r % 10];
+    });
+    double calls = (double)reps * boards.size();
+    std::cout << "permuted columns: " << permutedMs * 1e6 / calls << " ns/call" << std::endl;
+    std::cout << "bitboards:        " << bitboardMs * 1e6 / calls << " ns/call (" << sink % 2 << ")" << std::endl;
+}
+
+// counts the move sequences of length depth from board, stopping at wins.
+// Without rescoring, moves claim a zero heuristic delta so makeMove skips the line scores.
+uint64_t perft(b5_v2::connect3dBoardFast& board, int depth, bool rescore) {
+    if (depth == 0) return 1;
+    uint64_t nodes = 0;
+    for (int c = 0; c < 16; c++) {
+        b5_v2::connect3dMoveFast m(c);
+        m.hasHeuristic = !rescore;
+        if (!board.isMoveLegal(m)) continue;
+        board.makeMove(m);
+        nodes += board.checkWin(&m) != player::NONE ? 1 : perft(board, depth - 1, rescore);
+        board.undoMove(m);
+    }
+    return nodes;
+}
+
+// make/undo throughput: perft from the bench positions
+void benchPerft() {
+    std::cout << "== Perft, depth 5 ==" << std::endl;
+    auto positions = benchPositions();
+
+    for (bool rescore : {true, false}) {
+        uint64_t nodes = 0;
+        double best = 0;
+        for (int run = 0; run < 5; run++) { // best of 5, timings on a busy machine only ever come out slow
+            nodes = 0;
+            double ms = timeMs([&] {
+                for (const auto& pos : positions) {
+                    b5_v2::connect3dBoardFast fast(pos);
+                    nodes += perft(fast, 5, rescore);
+                }
+            });
+            if (run == 0 || ms < best) best = ms;
+        }
+        std::cout << (rescore ? "with line scores: " : "board only:       ") << nodes << " leaves, " << best << " ms, "
+                  << nodes / best / 1000 << " M leaves/s" << std::endl;
+    }
+}
+
+// perft that plays every move forward on a copy of the board
+uint64_t perftCopy(const b5_v2::connect3dBoardFast& board, int depth) {
+    if (depth == 0) return 1;
+    uint64_t nodes = 0;
+    for (int c = 0; c < 16; c++) {
+        b5_v2::connect3dMoveFast m(c);
+        if (!board.isMoveLegal(m)) continue;
+        b5_v2::connect3dBoardFast child = board;
+        child.makeMove(m);
+        nodes += child.checkWin(&m) != player::NONE ? 1 : perftCopy(child, depth - 1);
+    }
+    return nodes;
+}
+
+// Orderings of packed move keys. MoveFactory used to find each move with a selection scan.
+void selectionSortKeys(std::array<uint32_t, 16>& keys, int count) {
+    for (int i = 0; i < count; i++) {
+        int best = i;
+        for (int j = i + 1; j < count; j++) if (keys[j] > keys[best]) best = j;
+        std::swap(keys[i], keys[best]);
+    }
+}
+
+// the insertion sort old/testing.cpp measured against std::sort
+void insertionSortKeys(std::array<uint32_t, 16>& keys, int count) {
+    for (int i = 1; i < count; i++) {
+        uint32_t key = keys[i];
+        int j = i - 1;
+        while (j >= 0 && keys[j] < key) {
+            keys[j + 1] = keys[j];
+            j--;
+        }
+        keys[j + 1] = key;
+    }
+}
+
+void benchSort() {
+    std::cout << "== Move ordering sorts, 8 to 16 packed keys ==" << std::endl;
+    std::mt19937 rng(12345);
+    const int sets = 100000;
+    std::vector<std::array<uint32_t, 16>> keySets(sets);
+    std::vector<int> counts(sets);
+    for (int t = 0; t < sets; t++) {
+        counts[t] = 8 + rng() % 9;
+        keySets[t] = {};
+        for (int i = 0; i < counts[t]; i++) keySets[t][i] = ((rng() % 700 + 1) << 8) | ((15 - i) << 4) | i;
+    }
+
+    auto run = [&](const char* name, auto sort) {
+        uint64_t sink = 0;
+        double best = 0;
+        for (int r = 0; r < 5; r++) { // best of 5
+            double ms = timeMs([&] {
+                for (int t = 0; t < sets; t++) {
+                    std::array<uint32_t, 16> keys = keySets[t];
+                    sort(keys, counts[t]);
+                    sink += keys[0] ^ keys[counts[t] - 1];
+                }
+            });
+            if (r == 0 || ms < best) best = ms;
+        }
+        std::cout << name << best * 1e6 / sets << " ns/sort (" << sink % 2 << ")" << std::endl;
+    };
+
+    int mismatches = 0;
+    for (int t = 0; t < sets; t++) {
+        auto a = keySets[t], b = keySets[t];
+        selectionSortKeys(a, counts[t]);
+        b5_v2::sortKeysDescending(b);
+        if (a != b) mismatches++;
+    }
+    std::cout << mismatches << " orders differing from the selection sort" << std::endl;
+
+    run("selection, first move only: ", [](std::array<uint32_t, 16>& keys, int count) {
+        int best = 0;
+        for (int j = 1; j < count; j++) if (keys[j] > keys[best]) best = j;
+        std::swap(keys[0], keys[best]);
+    });
+    run("selection:                  ", selectionSortKeys);
+    run("insertion:                  ", insertionSortKeys);
+    run("std::sort:                  ", [](std::array<uint32_t, 16>& keys, int count) { std::sort(keys.begin(), keys.begin() + count, std::greater<>()); });
+    run("branchless rank sort:       ", [](std::array<uint32_t, 16>& keys, int) { b5_v2::sortKeysDescending(keys); });
+}
+
+// copy-make against make/unmake, for the raw move cost and in the search
+void benchCopyMake() {
+    std::cout << "== Copy-make ==" << std::endl;
+    auto positions = benchPositions();
+
+    for (bool copy : {false, true}) {
+        uint64_t nodes = 0;
+        double best = 0;
+        for (int run = 0; run < 5; run++) { // best of 5
+            nodes = 0;
+            double ms = timeMs([&] {
+                for (const auto& pos : positions) {
+                    b5_v2::connect3dBoardFast fast(pos);
+                    nodes += copy ? perftCopy(fast, 5) : perft(fast, 5, true);
+                }
+            });
+            if (run == 0 || ms < best) best = ms;
+        }
+        std::cout << (copy ? "perft copy-make:  " : "perft make/undo:  ") << nodes << " leaves, " << best << " ms, "
+                  << nodes / best / 1000 << " M leaves/s" << std::endl;
+    }
+
+    mm5::searchOptions makeUndo, copyMake;
+    copyMake.copyMake = true;
+    compareOptions(positions, "make/undo ", "copy-make ", {8, 10}, makeUndo, copyMake);
+}
+
+int main(int argc, char** argv) {
+    std::string section = argc > 1 ? argv[1] : "all";
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    if (section == "all" || section == "smp") benchLazySmp();
+    if (section == "all" || section == "ybwc") benchYbwc();
+    if (section == "all" || section == "pvs") benchPvs();
+    if (section == "all" || section == "aspiration") benchAspiration();
+    if (section == "all" || section == "ordering") benchOrdering();
+    if (section == "all" || section == "mtdf") benchMtdf();
+    if (section == "all" || section == "lmr") benchLmr();
+    if (section == "all" || section == "quiescence") benchQuiescence();
+    if (section == "all" || section == "forced") benchForced();
+    if (section == "all" || section == "frontier") benchFrontier();
+    if (section == "all" || section == "ttmove") benchTTMove();
+    if (section == "all" || section == "tt") benchTTAging();
+    if (section == "all" || section == "ttkeys") benchTTKeys();
+    if (section == "all" || section == "canonical") benchCanonical();
+    if (section == "all" || section == "perft") benchPerft();
+    if (section == "all" || section == "copymake") benchCopyMake();
+    if (section == "all" || section == "sort") benchSort();
+
+    return 0;
+}
@@ -39,6 +39,13 @@ const std::vector<PlayerOption> playerOptions = {
     {"Minimax AI b4 v1", []() { return std::make_unique<MinimaxAI_b4_v1>(); }},
     {"Minimax AI b5 v1", []() { return std::make_unique<MinimaxAI_b5_v1>(); }},
     {"Minimax AI b5 v2", []() { return std::make_unique<MinimaxAI_b5_v2>(); }},
+    {"Minimax AI b5 v2 (100 ms/move)", []() { return std::make_unique<MinimaxAI_b5_v2>(64, 100.0); }},
+    {"Minimax AI b5 v2 (MTD(f))", []() {
+        auto ai = std::make_unique<MinimaxAI_b5_v2>();
+        ai->options.driver = mm5::MTDF;
+        return ai;
+    }},
+    {"Minimax AI b5 v2 (lazy SMP)", []() { return std::make_unique<MinimaxAI_b5_v2>(8, 0, std::max(1u, std::thread::hardware_concurrency())); }},
     {"Heuristic Bot", []() { return std::make_unique<HeuristicBot>(); }}
 };
 
@@ -6,6 +6,16 @@
 #include <limits>
 #include <cstdint>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <thread>
+#include <cmath>
 
 // Enable alpha beta pruning. Disabling can be helpful to test speedups in move gen/checking
 #define ALPHABETAPRUNING true
@@ -16,28 +26,140 @@
 namespace mm5 {
 
 //Flag for transposition table. Exact is the exact best move, LOWER_BOUND is beta, UPPER_BOUND is alpha.
-enum TTFlag { EMPTY = 0, EXACT, LOWER_BOUND, UPPER_BOUND };
+enum TTFlag : uint8_t { EMPTY = 0, EXACT, LOWER_BOUND, UPPER_BOUND };
 
 
-// this is the type for transposition table entries
+// this is the type for transposition table entries.
+// Positions are identified by their 64 bit canonical hash, so symmetric positions share an entry.
+// The flag, depth and best move are packed into 16 bits, and with the score and generation
+// the whole entry besides the key packs into one 64 bit word, see TTSlot.
 struct TTEntry {
+    uint64_t key; // canonical hash of the position
     int16_t score;
-    uint8_t depth; // the depth searched to
-    uint8_t bestmove; // the best move found in this position
-    TTFlag flag = TTFlag::EMPTY; // type of score
-    std::array<uint8_t, 10> positionCompressed; // compressed position
+    uint16_t data; // bits 0-7 best move, bits 8-13 depth searched to, bits 14-15 flag
+    uint8_t generation; // the search that stored or last used this entry
 
-    static bool positionEquals(const std::array<uint8_t, 10>& a, const std::array<uint8_t, 10>& b) {
-        for (int i = 0; i < 10; ++i) {
-            if (a[i] != b[i]) return false;
+    TTEntry() : key(0), score(0), data(0), generation(0) {}
+
+    TTEntry(uint64_t k, int16_t s, uint8_t d, uint8_t bm, TTFlag f, uint8_t g)
+        : key(k), score(s), data((uint16_t)(bm | (std::min<int>(d, 63) << 8) | (f << 14))), generation(g) {}
+
+    uint8_t bestmove() const { return data & 0xFF; } // the best move found in this position, in the canonical orientation
+    uint8_t depth() const { return (data >> 8) & 0x3F; } // the depth searched to
+    TTFlag flag() const { return (TTFlag)(data >> 14); } // type of score
+
+    // everything but the key, as stored in a slot
+    uint64_t payload() const { return (uint16_t)score | ((uint64_t)data << 16) | ((uint64_t)generation << 32); }
+
+    static TTEntry fromPayload(uint64_t key, uint64_t payload) {
+        TTEntry e;
+        e.key = key;
+        e.score = (int16_t)(payload & 0xFFFF);
+        e.data = (uint16_t)(payload >> 16);
+        e.generation = (uint8_t)(payload >> 32);
+        return e;
+    }
+};
+
+// Where an entry is kept. Search threads share the table without locks, so an entry is stored
+// as two atomic words: its payload, and its key XORed with the payload. A read that gets the halves of
+// two different writes decodes to a key that matches neither, so a torn entry only ever looks like a miss.
+struct TTSlot {
+    std::atomic<uint64_t> check{0}; // key ^ payload
+    std::atomic<uint64_t> payload{0};
+
+    TTEntry load() const {
+        uint64_t p = payload.load(std::memory_order_relaxed);
+        return TTEntry::fromPayload(check.load(std::memory_order_relaxed) ^ p, p);
+    }
+
+    void store(const TTEntry& e) {
+        uint64_t p = e.payload();
+        check.store(e.key ^ p, std::memory_order_relaxed);
+        payload.store(p, std::memory_order_relaxed);
+    }
+};
+
+static_assert(sizeof(TTSlot) == 16, "four entries must fit a cache line");
+
+// a bucket of four entries sharing one cache line
+struct alignas(64) TTCluster {
+    std::array<TTSlot, 4> slots;
+};
+
+// Transposition table. It outlives a single search, so every search gets a new generation
+// and entries are tagged with the generation that stored or last used them.
+// Entries from older generations are stale: their position may no longer be reachable.
+// The table is 4-way set associative: a hash selects a cluster by its low bits, and the position
+// may be in any of the cluster's entries. An empty table disables transposition lookups.
+struct transpositionTable {
+    std::vector<TTCluster> clusters;
+    uint8_t generation = 0;
+
+    // Optional copy of each entry's compressed position, to measure how often a key match is really
+    // another position. Benchmarking only: it costs a compressPosition() per probe and store.
+    std::vector<std::array<std::array<uint8_t, 10>, 4>> positions;
+
+    transpositionTable() = default;
+    explicit transpositionTable(size_t bytes) { resize(bytes); }
+
+    // uses the largest power of two number of clusters that fits in bytes
+    void resize(size_t bytes) {
+        size_t n = 0;
+        if (bytes >= sizeof(TTCluster)) for (n = 1; n * 2 * sizeof(TTCluster) <= bytes; n *= 2);
+        clusters = std::vector<TTCluster>(n);
+        if (!positions.empty()) positions.assign(n, {});
+    }
+
+    bool empty() const { return clusters.empty(); }
+
+    // starts a new generation. Call once per move searched, not per iteration.
+    void newSearch() { generation++; }
+
+    TTCluster& cluster(uint64_t hash) { return clusters[hash & (clusters.size() - 1)]; }
+
+    // returns the slot holding the position with this hash and its entry in found, or nullptr
+    TTSlot* probe(uint64_t hash, TTEntry& found) {
+        for (TTSlot& slot : cluster(hash).slots) {
+            TTEntry e = slot.load();
+            if (e.flag() != TTFlag::EMPTY && e.key == hash) {
+                found = e;
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    // returns the slot to store the position with this hash in, and its current entry in current: the one
+    // already holding it, else an empty one, else the least valuable one. Stale entries are evicted before
+    // fresh ones, then shallow before deep.
+    TTSlot* replacement(uint64_t hash, TTEntry& current) {
+        TTSlot* victim = nullptr;
+        int victimWorth = std::numeric_limits<int>::max();
+        for (TTSlot& slot : cluster(hash).slots) {
+            TTEntry e = slot.load();
+            if (e.flag() == TTFlag::EMPTY || e.key == hash) {
+                current = e;
+                return &slot;
+            }
+            int worth = e.depth() + (e.generation == generation ? 256 : 0);
+            if (worth < victimWorth) {
+                victim = &slot;
+                victimWorth = worth;
+                current = e;
+            }
         }
-        return true;
+        return victim;
     }
-    //uint64_t z_hash = 0; // the hash of the position
-    TTEntry() : score(0), depth(0), bestmove(0), flag(TTFlag::EMPTY) { positionCompressed.fill(0); }
 
-    TTEntry(int16_t s, uint8_t d, uint8_t bm, TTFlag f, std::array<uint8_t, 10> p) 
-        : score(s), depth(d), bestmove(bm), flag(f), positionCompressed(p) {}
+    // starts keeping the compressed position of every entry stored from now on
+    void enableVerification() { positions.assign(clusters.size(), {}); }
+    bool verifying() const { return !positions.empty(); }
+
+    std::array<uint8_t, 10>& positionOf(const TTSlot* slot) {
+        size_t i = (reinterpret_cast<const char*>(slot) - reinterpret_cast<const char*>(clusters.data())) / sizeof(TTSlot);
+        return positions[i / 4][i % 4];
+    }
 };
 
 
@@ -72,151 +194,523 @@ struct board_t {
     virtual std::array<uint8_t, 10> compressPosition() const = 0;
 };
 
+// forcing moves in a position, as bitmasks of move numbers.
+// wins complete a line for the player to move, blocks are where the opponent would complete one.
+struct forcingMoves_t {
+    uint16_t wins = 0;
+    uint16_t blocks = 0;
+};
+
+// A move one half move from the depth limit, judged without playing it. The child would only
+// return its heuristic, unless the move wins or leaves the reply forcing moves for quiescence.
+// score is the heuristic after the move, from the mover's side.
+struct frontierMove_t {
+    bool wins = false;
+    bool forcingReply = false;
+    int16_t score = 0;
+};
+
+// Stages of a staged move factory, in the order their moves are searched
+enum MoveStage : uint8_t { STAGE_TT_MOVE = 0, STAGE_FORCING, STAGE_KILLERS, STAGE_QUIET, STAGE_COUNT };
+
 // statistics type
 struct stat_t {
     uint64_t nodesExplored = 0; // total leaf nodes
     uint64_t hashCollisions = 0; // transposition table collisions
+    uint64_t ttHitsFresh = 0; // transposition table hits on entries of the current generation
+    uint64_t ttHitsStale = 0; // transposition table hits on entries of an older generation
+    uint64_t ttProbes = 0; // transposition table lookups
+    uint64_t ttFalsePositives = 0; // key matches on a different position, only counted when the table verifies
+    uint64_t pvsResearches = 0; // null window searches that failed high and were searched again
+    uint64_t aspirationFailLows = 0; // root searches that failed low on their aspiration window
+    uint64_t aspirationFailHighs = 0; // root searches that failed high on their aspiration window
+    uint64_t cutoffs = 0; // nodes that failed high
+    uint64_t firstMoveCutoffs = 0; // nodes that failed high on the first move searched
+    uint64_t mtdfPasses = 0; // null window root searches made by MTD(f)
+    uint64_t lmrReductions = 0; // moves searched at reduced depth
+    uint64_t lmrResearches = 0; // reduced moves that beat alpha and were searched again at full depth
+    uint64_t quiescenceNodes = 0; // forced blocks searched past the depth limit
+    uint64_t forcedWins = 0; // nodes cut short because the side to move could win at once
+    uint64_t forcedBlocks = 0; // nodes where the only move searched was the block of a single threat
+    uint64_t doubleThreats = 0; // nodes cut short because the opponent had two threats to block
+    uint64_t frontierLeaves = 0; // children of frontier nodes scored without being searched
+    std::array<uint64_t, STAGE_COUNT> stageCutoffs = {}; // cutoffs by the move factory stage of the refuting move
+    int depthReached = 0; // deepest fully completed search, for iterative deepening
+    std::vector<uint64_t> nodesPerThread; // nodes explored by each search thread, main thread first
+};
+
+// Limits and abort signal for a search.
+// The stop flag is atomic so it can be raised from another thread.
+// A search stops when its own flag or that of any parent is raised.
+struct searchControl {
+    std::atomic<bool> stop{false};
+    bool hasDeadline = false;
+    std::chrono::steady_clock::time_point deadline;
+    const searchControl* parent = nullptr;
+
+    searchControl() = default;
+    explicit searchControl(const searchControl* parent) : parent(parent) {
+        if (parent) {
+            hasDeadline = parent->hasDeadline;
+            deadline = parent->deadline;
+        }
+    }
+
+    // sets the deadline to timeMs milliseconds from now
+    void setTimeBudget(double timeMs) {
+        hasDeadline = true;
+        deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(timeMs * 1000));
+    }
+
+    // returns true if the search should unwind. The clock is only read once nodes reaches nextCheck,
+    // which then moves 1024 nodes on. Nodes may be counted in steps, so this doesn't rely on hitting
+    // an exact multiple. Several threads can share a control, so each keeps its own nextCheck.
+    bool shouldStop(uint64_t nodes, uint64_t& nextCheck) {
+        if (stopped()) return true;
+        if (hasDeadline && nodes >= nextCheck) {
+            nextCheck = nodes + 1024;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                stop.store(true, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool stopped() const { return stop.load(std::memory_order_relaxed) || (parent && parent->stopped()); }
+};
+
+
+// Late move reductions in half moves, by depth remaining and by how many moves were searched before
+using lmrTable = std::array<std::array<uint8_t, 16>, 64>;
+
+// builds a reduction table that grows with the log of both depth remaining and move number.
+// Nothing is reduced below minDepth half moves remaining or before move number minMove, and
+// a reduction always leaves at least one half move to search.
+inline lmrTable makeLmrTable(double divisor = 2.0, int minDepth = 3, int minMove = 3) {
+    lmrTable table;
+    for (int d = 0; d < 64; ++d) {
+        for (int m = 0; m < 16; ++m) {
+            int r = 0;
+            if (d >= minDepth && m >= minMove) {
+                r = std::max(1, (int)(0.5 + std::log(d) * std::log(m) / divisor));
+                r = std::min(r, d - 1);
+            }
+            table[d][m] = (uint8_t)r;
+        }
+    }
+    return table;
+}
+
+inline const lmrTable& defaultLmrTable() {
+    static const lmrTable table = makeLmrTable();
+    return table;
+}
+
+// How the root of a search is driven
+enum SearchDriver { ALPHA_BETA = 0, MTDF };
+
+// Settings for a search. Defaults are what the engines play with.
+struct searchOptions {
+    // ALPHA_BETA searches the root with one window (or an aspiration window), MTDF with a series of null windows
+    SearchDriver driver = ALPHA_BETA;
+    // principal variation search: every move after the first is searched with a null window
+    // and only re-searched with the full window if it fails high
+    bool pvs = true;
+    // aspiration windows: the root is searched with a window of +-aspirationDelta around the expected
+    // score, which is widened geometrically on the failing side until the score falls inside it
+    bool aspiration = true;
+    int16_t aspirationDelta = 32;
+    // order moves by killer moves and history, on boards that support it
+    bool killersAndHistory = true;
+    // late move reductions: late moves the board doesn't consider tactical are searched shallower
+    // with a null window, and searched again at full depth only if they beat alpha
+    bool lmr = true;
+    const lmrTable* lmrReductions = &defaultLmrTable();
+    // half moves of forced play searched past the depth limit, on boards that can find forcing moves. 0 disables it.
+    int quiescenceDepth = 4;
+    // on boards that can find forcing moves, settle immediate wins and double threats without a search
+    // and search only the block when the opponent has a single threat
+    bool forcedMoves = true;
+    // search the transposition table's best move first, on boards whose move factory can take it
+    bool ttMoveFirst = true;
+    // score the children of nodes one half move from the depth limit without searching them, on boards
+    // that can judge a move unplayed. Children that win or need quiescence are still searched.
+    bool frontierFusion = true;
+    // copy-make: children are searched on a copy of the board in a per-thread stack, one slot per half move,
+    // so moves are only ever played forward. Otherwise they are made and unmade on the one board.
+    bool copyMake = false;
+};
+
+// Move ordering tables, kept per search thread so threads never contend on them.
+// Killers are the last two moves that caused a beta cutoff at each ply.
+// History counts cutoffs by the column of the opponent's last move and the cell the move lands on,
+// like a chess butterfly table, weighted by the depth remaining.
+struct orderingTables {
+    static constexpr int maxPly = 64;
+    std::array<std::array<uint8_t, 2>, maxPly> killers;
+    std::array<std::array<int32_t, 64>, 16> history;
+
+    orderingTables() {
+        for (auto& k : killers) k.fill(255);
+        for (auto& h : history) h.fill(0);
+    }
+
+    void addKiller(int ply, uint8_t move) {
+        if (ply >= maxPly || killers[ply][0] == move) return;
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    void addHistory(int prevColumn, int cell, int depth) {
+        history[prevColumn][cell] += depth * depth;
+    }
+
+    // halves history, so that it follows the game as it moves on
+    void age() {
+        for (auto& h : history) for (auto& v : h) v /= 2;
+    }
+
+    // the tables of the calling thread
+    static orderingTables& forThisThread() {
+        static thread_local orderingTables tables;
+        return tables;
+    }
 };
 
+// What a search carries down the tree, besides the board.
+struct searchContext {
+    stat_t& stats;
+    transpositionTable& tt;
+    searchControl* control;
+    const searchOptions& options;
+    orderingTables& ordering;
+    uint64_t nextClockCheck = 0; // node count at which control next reads the clock
+};
+
+// score bound used by negamax. Windows are kept inside [-scoreInf, scoreInf] so they can always be negated.
+constexpr int16_t scoreInf = std::numeric_limits<int16_t>::max();
+
+// score of a win, from the winner's side, found halfMoveNum half moves from the root.
+// Earlier wins score higher.
+constexpr int16_t winScore(int halfMoveNum) {
+    return scoreInf - halfMoveNum - 1;
+}
+
+// true if score is a forced win for the side it is from
+constexpr bool isWinScore(int16_t score) {
+    return score > scoreInf - 66;
+}
+
 
+// Per-thread boards for copy-make, indexed by the half move of the position they hold.
+// A game has 64 half moves, so no search goes deeper than the last slot.
 template<typename BoardType>
-int16_t minimax(BoardType& board, player player, int halfMoveNum, int maxHalfMoveNum, 
-    typename BoardType::MoveType* bestMoveRet, stat_t& stats, std::vector<TTEntry>& tt) {
+std::array<BoardType, 65>& copyMakeStack() {
+    static thread_local std::array<BoardType, 65> stack;
+    return stack;
+}
 
-    return minimax<BoardType>(board, player, halfMoveNum, maxHalfMoveNum, bestMoveRet, stats, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max(), (typename BoardType::MoveType*)nullptr, tt);
+// plays m from the position at halfMoveNum and returns the board holding the result:
+// the same board with make/unmake, the next slot of the copy-make stack otherwise
+template<typename BoardType>
+BoardType& playMove(BoardType& board, searchContext& ctx, int halfMoveNum, typename BoardType::MoveType m) {
+    if (!ctx.options.copyMake) {
+        board.makeMove(m);
+        return board;
+    }
+    BoardType& child = copyMakeStack<BoardType>()[halfMoveNum + 1];
+    child = board;
+    child.makeMove(m);
+    return child;
 }
 
+// takes back a move played by playMove. A copy is simply left behind.
+template<typename BoardType>
+void takeBackMove(BoardType& board, searchContext& ctx, typename BoardType::MoveType m) {
+    if (!ctx.options.copyMake) board.undoMove(m);
+}
 
-// Runs the minimax algorithm on a given board
-// Returns the heuristic score of the best move.
-// if bestMoveRet is not nullptr, populates it with the best move found.
+// Boards with a symmetric hash share TT entries between symmetric positions, so they store
+// best moves in the canonical orientation and map them back to the probing position's.
 template<typename BoardType>
-int16_t minimax(BoardType& board, player player, int halfMoveNum, int maxHalfMoveNum, 
-    typename BoardType::MoveType* bestMoveRet, stat_t& stats, int16_t alpha, int16_t beta, typename BoardType::MoveType* lastMove, std::vector<TTEntry>& tt) {
+uint8_t toTTMove(const BoardType& board, const typename BoardType::MoveType& m) {
+    if constexpr (requires { board.canonicalMove(m); }) return board.canonicalMove(m);
+    else return m.deflate();
+}
+
+template<typename BoardType>
+typename BoardType::MoveType fromTTMove(const BoardType& board, uint8_t m) {
+    if constexpr (requires { board.moveFromCanonical(m); }) return board.moveFromCanonical(m);
+    else return typename BoardType::MoveType(m);
+}
+
+// Quiescence search at the depth limit. Only forcing moves are searched: a win for the player to move
+// ends the search, a double threat by the opponent is a loss, and a single threat must be blocked.
+// Positions without threats are scored by the heuristic. qDepth bounds the forced blocks searched.
+// Scores are from the point of view of the player to move, as in negamax.
+template<typename BoardType>
+int16_t quiescence(BoardType& board, searchContext& ctx, player player, int halfMoveNum, int qDepth,
+    int16_t alpha, int16_t beta) {
+
+    using MoveType = typename BoardType::MoveType;
+
+    int16_t standPat = player == player::A ? board.heuristic() : -board.heuristic();
+    if (qDepth <= 0) return standPat;
+
+    forcingMoves_t forcing = board.forcingMoves(player);
+    if (forcing.wins) return winScore(halfMoveNum + 1);
+    if (!forcing.blocks) return standPat;
+    if (forcing.blocks & (forcing.blocks - 1)) return -winScore(halfMoveNum + 2);
+
+    #if statisticsEnabled
+    ctx.stats.quiescenceNodes++;
+    #endif
+    MoveType m(std::countr_zero(forcing.blocks));
+    ::player next = (player == player::A) ? player::B : player::A;
+    BoardType& child = playMove(board, ctx, halfMoveNum, m);
+    int16_t score = -quiescence<BoardType>(child, ctx, next, halfMoveNum + 1, qDepth - 1, -beta, -alpha);
+    takeBackMove(board, ctx, m);
+    return score;
+}
+
+
+// Negamax search with principal variation search.
+// Scores are from the point of view of the player to move, so one loop serves both players.
+// Returns the score of the best move, and populates bestMoveRet with it if not nullptr.
+// If ctx.control signals a stop, the search unwinds early and the result is meaningless.
+template<typename BoardType>
+int16_t negamax(BoardType& board, searchContext& ctx, player player, int halfMoveNum, int maxHalfMoveNum,
+    int16_t alpha, int16_t beta, typename BoardType::MoveType* lastMove, typename BoardType::MoveType* bestMoveRet) {
 
     using MoveType = typename BoardType::MoveType;
+    stat_t& stats = ctx.stats;
+    transpositionTable& tt = ctx.tt;
+
+    if (ctx.control && ctx.control->shouldStop(stats.nodesExplored, ctx.nextClockCheck)) return 0;
 
     // Transposition Table Lookup
     uint64_t hash = 0;
-    std::array<uint8_t, 10> boardPos;
+    MoveType ttMove = MoveType();
 
     if (!tt.empty()) {
         hash = board.hash();
-        boardPos = board.compressPosition();
-        size_t idx = hash % tt.size();
-        const TTEntry& entry = tt[idx];
+        #if statisticsEnabled
+        stats.ttProbes++;
+        #endif
+
+        TTEntry entry;
+        TTSlot* found = tt.probe(hash, entry);
+        if (found && tt.verifying() && tt.positionOf(found) != board.compressPosition()) {
+            #if statisticsEnabled
+            stats.ttFalsePositives++;
+            #endif
+            found = nullptr;
+        }
         
-        if (entry.flag != TTFlag::EMPTY && TTEntry::positionEquals(entry.positionCompressed, boardPos)) {
-            if (entry.depth >= (maxHalfMoveNum - halfMoveNum)) {
-                if (entry.flag == EXACT) {
-                    if (bestMoveRet) *bestMoveRet = MoveType(entry.bestmove);
+        if (found) {
+            // a stale entry that is still reachable is as good as a fresh one, so keep it from being evicted.
+            // Only stale entries are written back, so fresh hits stay reads.
+            #if statisticsEnabled
+            if (entry.generation == tt.generation) stats.ttHitsFresh++;
+            else stats.ttHitsStale++;
+            #endif
+            if (entry.generation != tt.generation) {
+                entry.generation = tt.generation;
+                found->store(entry);
+            }
+            ttMove = fromTTMove(board, entry.bestmove());
+
+            if (entry.depth() >= (maxHalfMoveNum - halfMoveNum)) {
+                if (entry.flag() == EXACT) {
+                    if (bestMoveRet) *bestMoveRet = ttMove;
                     return entry.score;
-                } else if (entry.flag == LOWER_BOUND) {
+                } else if (entry.flag() == LOWER_BOUND) {
                     alpha = std::max(alpha, entry.score);
-                } else if (entry.flag == UPPER_BOUND) {
+                } else if (entry.flag() == UPPER_BOUND) {
                     beta = std::min(beta, entry.score);
                 }
                 if (alpha >= beta) {
-                    if (bestMoveRet) *bestMoveRet = MoveType(entry.bestmove);
+                    if (bestMoveRet) *bestMoveRet = ttMove;
                     return entry.score;
                 }
             }
         }
     }
 
-    MoveType bestmove = MoveType();
-
-    // check if someone won
-    auto pwin = board.checkWin(lastMove);
-
-    // if someone won, return a score of intMax minus 1 per move away it is, plus 1
-    // this incentivizes earlier wins
-    if (pwin != player::NONE) {
-        return (pwin == player::A ? std::numeric_limits<int16_t>::max() - halfMoveNum - 1: std::numeric_limits<int16_t>::min() + halfMoveNum + 1);
+    // check if someone won. It can only be the player who just moved, so this is a loss.
+    // returns a score of intMax minus 1 per move away it is, plus 1. this incentivizes earlier wins
+    if (board.checkWin(lastMove) != player::NONE) {
+        return -winScore(halfMoveNum);
     }
 
-    // depth limit check
+    // depth limit check. Boards that can find forcing moves play them out first.
     if (halfMoveNum >= maxHalfMoveNum) {
-        return board.heuristic();
+        if constexpr (requires { board.forcingMoves(player); }) {
+            if (ctx.options.quiescenceDepth > 0) {
+                return quiescence<BoardType>(board, ctx, player, halfMoveNum, ctx.options.quiescenceDepth, alpha, beta);
+            }
+        }
+        return player == player::A ? board.heuristic() : -board.heuristic();
     }
 
     // Keep a copy of the original alpha to determine the node type later
     int16_t original_alpha = alpha;
+    ::player next = (player == player::A) ? player::B : player::A;
 
-    auto moves = board.createMoveFactory(player);
+    // forced positions don't need the move list. A win is taken, two threats can't both be blocked,
+    // and a single threat has to be blocked, so that is the only move searched.
+    if constexpr (requires { board.forcingMoves(player); }) {
+        if (ctx.options.forcedMoves) {
+            forcingMoves_t forcing = board.forcingMoves(player);
+            if (forcing.wins) {
+                #if statisticsEnabled
+                stats.forcedWins++;
+                #endif
+                if (bestMoveRet) *bestMoveRet = MoveType(std::countr_zero(forcing.wins));
+                return winScore(halfMoveNum + 1);
+            }
+            if (forcing.blocks & (forcing.blocks - 1)) {
+                #if statisticsEnabled
+                stats.doubleThreats++;
+                #endif
+                if (bestMoveRet) *bestMoveRet = MoveType(std::countr_zero(forcing.blocks));
+                return -winScore(halfMoveNum + 2);
+            }
+            if (forcing.blocks) {
+                #if statisticsEnabled
+                stats.forcedBlocks++;
+                stats.nodesExplored++;
+                #endif
+                MoveType m(std::countr_zero(forcing.blocks));
+                BoardType& child = playMove(board, ctx, halfMoveNum, m);
+                int16_t score = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum, -beta, -alpha, &m, nullptr);
+                takeBackMove(board, ctx, m);
+                if (bestMoveRet) *bestMoveRet = m;
+                return score;
+            }
+        }
+    }
 
-    int16_t bestscore;
+    // boards that support it order moves with the killer and history tables
+    int prevColumn = (lastMove && lastMove->isValid()) ? lastMove->deflate() : -1;
+    auto moves = [&]() {
+        if constexpr (requires { board.createMoveFactory(player, &ctx.ordering, halfMoveNum, prevColumn); }) {
+            if (ctx.options.killersAndHistory) return board.createMoveFactory(player, &ctx.ordering, halfMoveNum, prevColumn);
+        }
+        return board.createMoveFactory(player);
+    }();
+    if constexpr (requires { moves.setFirstMove(ttMove); }) {
+        if (ctx.options.ttMoveFirst && ttMove.isValid()) moves.setFirstMove(ttMove);
+    }
 
+    // set worst score so that first move is always taken
+    int16_t bestscore = -scoreInf;
+    MoveType bestmove = MoveType();
     bool isDraw = true;
+    int moveNum = 0;
 
-    if (player == player::A) {
-        // set worst score so that first move is always taken
-        bestscore = std::numeric_limits<int16_t>::min();
+    bool frontier = ctx.options.frontierFusion && halfMoveNum + 1 == maxHalfMoveNum;
 
-        // go through moves
-        for(MoveType m = moves.getNextBestMove(); m.isValid(); m = moves.getNextBestMove()) {
-            #if statisticsEnabled
-            stats.nodesExplored++;
-            #endif
-            isDraw = false;
-            // check the move
-            board.makeMove(m);
-            int16_t newscore = minimax<BoardType>(board, player::B, halfMoveNum+1, maxHalfMoveNum, nullptr, stats, alpha, beta, &m, tt);
-            board.undoMove(m);
-
-            if (bestscore < newscore) {
-                bestscore = newscore;
-                bestmove = m;
+    // go through moves
+    for(MoveType m = moves.getNextBestMove(); m.isValid(); m = moves.getNextBestMove()) {
+        #if statisticsEnabled
+        stats.nodesExplored++;
+        #endif
+        
+        // at the frontier, the children are leaves and the board can score them in place
+        int16_t newscore = 0;
+        bool fused = false;
+        if constexpr (requires { board.frontierMove(m); }) {
+            if (frontier) {
+                frontierMove_t f = board.frontierMove(m);
+                fused = f.wins || !f.forcingReply || ctx.options.quiescenceDepth <= 0;
+                newscore = f.wins ? winScore(halfMoveNum + 1) : f.score;
+                #if statisticsEnabled
+                if (fused) stats.frontierLeaves++;
+                #endif
             }
+        }
 
-            // Optimization: If we found a winning move, stop.
-            if (newscore > std::numeric_limits<int16_t>::max() - 66){
-                alpha = bestscore;
-                break;
+        if (!fused) {
+            // late quiet moves are searched shallower. Boards that can't tell tactical moves apart are never reduced.
+            int reduction = 0;
+            if (ctx.options.lmr && moveNum > 0) {
+                if constexpr (requires { board.isTactical(m); }) {
+                    int depthLeft = std::min(maxHalfMoveNum - halfMoveNum, 63);
+                    if (!board.isTactical(m)) reduction = (*ctx.options.lmrReductions)[depthLeft][std::min(moveNum, 15)];
+                }
             }
 
-            #if ALPHABETAPRUNING
-            // update alpha
-            alpha = std::max(alpha, bestscore);
-            if (alpha >= beta) {
-                break; // Prune the remaining branches
+            // check the move. The first move gets the full window, the rest a null window
+            // that only proves they are no better than alpha.
+            BoardType& child = playMove(board, ctx, halfMoveNum, m);
+            if (moveNum == 0) {
+                newscore = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum, -beta, -alpha, &m, nullptr);
+            } else {
+                bool searched = false;
+                if (reduction > 0) {
+                    #if statisticsEnabled
+                    stats.lmrReductions++;
+                    #endif
+                    newscore = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum - reduction, -alpha-1, -alpha, &m, nullptr);
+                    searched = newscore <= alpha;
+                    #if statisticsEnabled
+                    if (!searched) stats.lmrResearches++;
+                    #endif
+                }
+                if (!searched && !ctx.options.pvs) {
+                    newscore = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum, -beta, -alpha, &m, nullptr);
+                } else if (!searched) {
+                    newscore = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum, -alpha-1, -alpha, &m, nullptr);
+                    if (newscore > alpha && newscore < beta) {
+                        #if statisticsEnabled
+                        stats.pvsResearches++;
+                        #endif
+                        newscore = -negamax<BoardType>(child, ctx, next, halfMoveNum+1, maxHalfMoveNum, -beta, -alpha, &m, nullptr);
+                    }
+                }
             }
-            #endif
+            takeBackMove(board, ctx, m);
         }
-    } else {
-        bestscore = std::numeric_limits<int16_t>::max();
+        isDraw = false;
+        if (ctx.control && ctx.control->stopped()) break;
 
-        // go through moves
-        for(MoveType m = moves.getNextBestMove(); m.isValid(); m = moves.getNextBestMove()) {
-            #if statisticsEnabled
-            stats.nodesExplored++;
-            #endif
-            isDraw = false;
-            // check the move
-            board.makeMove(m);
-            int16_t newscore = minimax<BoardType>(board, player::A, halfMoveNum+1, maxHalfMoveNum, nullptr, stats, alpha, beta, &m, tt);
-            board.undoMove(m);
-
-            if (bestscore > newscore) {
-                bestscore = newscore;
-                bestmove = m;
-            }
+        if (bestscore < newscore) {
+            bestscore = newscore;
+            bestmove = m;
+        }
 
-            // Optimization: If we found a winning move, stop.
-            if (newscore < std::numeric_limits<int16_t>::min() + 66) {
-                beta = bestscore;
-                break;
-            }
+        // Optimization: If we found a winning move, stop.
+        if (isWinScore(newscore)) {
+            alpha = std::max(alpha, bestscore);
+            break;
+        }
 
-            #if ALPHABETAPRUNING
-            // update beta
-            beta = std::min(beta, bestscore);
-            if (beta <= alpha) {
-                break; // Prune the remaining branches
-            }
+        #if ALPHABETAPRUNING
+        // update alpha
+        alpha = std::max(alpha, bestscore);
+        if (alpha >= beta) {
+            #if statisticsEnabled
+            stats.cutoffs++;
+            if (moveNum == 0) stats.firstMoveCutoffs++;
+            if constexpr (requires { moves.stage(); }) stats.stageCutoffs[moves.stage()]++;
             #endif
+            // remember the move that refuted this node, for ordering its siblings and later searches
+            if (ctx.options.killersAndHistory) {
+                ctx.ordering.addKiller(halfMoveNum, m.deflate());
+                if constexpr (requires { board.moveCell(m); }) {
+                    if (prevColumn >= 0) ctx.ordering.addHistory(prevColumn, board.moveCell(m), maxHalfMoveNum - halfMoveNum);
+                }
+            }
+            break; // Prune the remaining branches
         }
+        #endif
+        moveNum++;
     }
+
+    // an interrupted search must not leave partial results behind
+    if (ctx.control && ctx.control->stopped()) return bestscore;
     
     // out the best move if created, then return the score
     if (bestMoveRet != nullptr) *bestMoveRet = bestmove;
@@ -230,22 +724,426 @@ int16_t minimax(BoardType& board, player player, int halfMoveNum, int maxHalfMov
             flag = LOWER_BOUND;
         }
 
-        size_t idx = hash % tt.size();
+        TTEntry entry;
+        TTSlot* slot = tt.replacement(hash, entry);
+        bool samePosition = entry.flag() != TTFlag::EMPTY && entry.key == hash;
         
-        if (tt[idx].flag != TTFlag::EMPTY && !TTEntry::positionEquals(tt[idx].positionCompressed, boardPos)) {
+        if (entry.flag() != TTFlag::EMPTY && !samePosition) {
             #if statisticsEnabled
             stats.hashCollisions++;
             #endif
         }
 
-        // Replace if empty or if new search is deeper or same depth
-        if (tt[idx].flag == TTFlag::EMPTY || (maxHalfMoveNum - halfMoveNum) >= tt[idx].depth) {
-            tt[idx] = {bestscore, (uint8_t)(maxHalfMoveNum - halfMoveNum), bestmove.deflate(), flag, boardPos};
+        // Replace another position's entry, or this position's if stale or if new search is deeper or same depth
+        if (!samePosition || entry.generation != tt.generation || (maxHalfMoveNum - halfMoveNum) >= entry.depth()) {
+            slot->store({hash, bestscore, (uint8_t)(maxHalfMoveNum - halfMoveNum), toTTMove(board, bestmove), flag, tt.generation});
+            if (tt.verifying()) tt.positionOf(slot) = board.compressPosition();
         }
     }
 
     if (isDraw) return 0;
     return bestscore;
+}
+
+
+// Runs the minimax algorithm on a given board
+// Returns the heuristic score of the best move, where positive is good for player A.
+// alpha and beta are also from player A's point of view.
+// if bestMoveRet is not nullptr, populates it with the best move found.
+// if control is not nullptr and it signals a stop, the search unwinds early. The result is then meaningless.
+template<typename BoardType>
+int16_t minimax(BoardType& board, player player, int halfMoveNum, int maxHalfMoveNum, 
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, int16_t alpha, int16_t beta, typename BoardType::MoveType* lastMove, transpositionTable& tt,
+    searchControl* control = nullptr, const searchOptions& options = searchOptions()) {
+
+    searchContext ctx{stats, tt, control, options, orderingTables::forThisThread()};
+    alpha = std::max(alpha, (int16_t)-scoreInf);
+
+    // a new root search: let old history fade
+    if (halfMoveNum == 0) ctx.ordering.age();
+
+    if (player == player::A) {
+        return negamax<BoardType>(board, ctx, player, halfMoveNum, maxHalfMoveNum, alpha, beta, lastMove, bestMoveRet);
+    }
+    return -negamax<BoardType>(board, ctx, player, halfMoveNum, maxHalfMoveNum, -beta, -alpha, lastMove, bestMoveRet);
+}
+
+template<typename BoardType>
+int16_t minimax(BoardType& board, player player, int halfMoveNum, int maxHalfMoveNum, 
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt,
+    searchControl* control = nullptr, const searchOptions& options = searchOptions()) {
+
+    return minimax<BoardType>(board, player, halfMoveNum, maxHalfMoveNum, bestMoveRet, stats, -scoreInf, scoreInf, (typename BoardType::MoveType*)nullptr, tt, control, options);
+}
+
+// Aspiration window root search. Searches the root with a narrow window around expected, a score from
+// player A's point of view, and widens the failing side geometrically until the score falls inside.
+// Returns the same score as minimax with a full window, usually for fewer nodes.
+template<typename BoardType>
+int16_t aspirationSearch(BoardType& board, player player, int maxHalfMoveNum, int16_t expected,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt, searchControl* control = nullptr,
+    const searchOptions& options = searchOptions()) {
+
+    int delta = options.aspirationDelta;
+    int16_t alpha = (int16_t)std::max(-(int)scoreInf, expected - delta);
+    int16_t beta = (int16_t)std::min((int)scoreInf, expected + delta);
+
+    while (true) {
+        int16_t score = minimax<BoardType>(board, player, 0, maxHalfMoveNum, bestMoveRet, stats, alpha, beta,
+            (typename BoardType::MoveType*)nullptr, tt, control, options);
+        if (control && control->stopped()) return score;
+
+        if (score <= alpha && alpha > -scoreInf) {
+            #if statisticsEnabled
+            stats.aspirationFailLows++;
+            #endif
+            delta *= 2;
+            alpha = (int16_t)std::max(-(int)scoreInf, score - delta);
+        } else if (score >= beta && beta < scoreInf) {
+            #if statisticsEnabled
+            stats.aspirationFailHighs++;
+            #endif
+            delta *= 2;
+            beta = (int16_t)std::min((int)scoreInf, score + delta);
+        } else {
+            return score;
+        }
+    }
+}
+
+// MTD(f) driver. Converges on the minimax value with a series of null window searches, starting from
+// guess, a score from player A's point of view. Each pass moves one bound, and leans on the bounds
+// earlier passes left in tt, so it is only worth using with a transposition table.
+// Returns the same score as minimax with a full window.
+template<typename BoardType>
+int16_t mtdf(BoardType& board, player player, int maxHalfMoveNum, int16_t guess,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt, searchControl* control = nullptr,
+    const searchOptions& options = searchOptions()) {
+
+    using MoveType = typename BoardType::MoveType;
+
+    int16_t score = guess;
+    int16_t lower = -scoreInf, upper = scoreInf;
+    MoveType move, bestmove;
+
+    while (lower < upper) {
+        int16_t beta = (score == lower) ? score + 1 : score;
+        #if statisticsEnabled
+        stats.mtdfPasses++;
+        #endif
+        score = minimax<BoardType>(board, player, 0, maxHalfMoveNum, &move, stats, beta - 1, beta,
+            (typename BoardType::MoveType*)nullptr, tt, control, options);
+        if (control && control->stopped()) return score;
+
+        // a pass that fails high proves its move reaches the new lower bound, so that move is kept
+        if (score < beta) {
+            upper = score;
+            if (!bestmove.isValid()) bestmove = move;
+        } else {
+            lower = score;
+            bestmove = move;
+        }
+    }
+
+    if (bestMoveRet) *bestMoveRet = bestmove;
+    return score;
+}
+
+// Searches the root with the driver options selects. expected is the score the search is expected
+// to return, from player A's point of view, if hasExpected is set. MTD(f) starts from it and
+// aspiration windows are centred on it.
+template<typename BoardType>
+int16_t searchRoot(BoardType& board, player player, int maxHalfMoveNum, int16_t expected, bool hasExpected,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt, searchControl* control = nullptr,
+    const searchOptions& options = searchOptions()) {
+
+    if (options.driver == MTDF) {
+        return mtdf<BoardType>(board, player, maxHalfMoveNum, hasExpected ? expected : 0, bestMoveRet, stats, tt, control, options);
+    }
+    if (options.aspiration && hasExpected) {
+        return aspirationSearch<BoardType>(board, player, maxHalfMoveNum, expected, bestMoveRet, stats, tt, control, options);
+    }
+    return minimax<BoardType>(board, player, 0, maxHalfMoveNum, bestMoveRet, stats, tt, control, options);
+}
+
+// Iterative deepening driver. Searches depth 1, 2, ... up to maxHalfMoveNum, reusing tt between iterations
+// so each iteration starts from the bounds of the previous one.
+// Returns the score of the last completed iteration, and populates bestMoveRet with its best move.
+// If control has a deadline, the iteration it interrupts is thrown away. Depth 1 always completes
+// so there is always a move to return. Each iteration expects the score of the one before, for
+// aspiration windows or MTD(f).
+template<typename BoardType>
+int16_t iterativeDeepening(BoardType& board, player player, int maxHalfMoveNum,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt, searchControl* control = nullptr,
+    const searchOptions& options = searchOptions()) {
+
+    using MoveType = typename BoardType::MoveType;
+
+    auto start = std::chrono::steady_clock::now();
+    int16_t bestscore = minimax<BoardType>(board, player, 0, 1, bestMoveRet, stats, tt, nullptr, options);
+    stats.depthReached = 1;
+
+    for (int depth = 2; depth <= maxHalfMoveNum; depth++) {
+        // a forced win or loss was found, searching deeper will not change it
+        if (isWinScore(bestscore) || isWinScore(-bestscore)) break;
+
+        // the next iteration costs several times the last one, so don't start it past half the budget
+        if (control && control->hasDeadline) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= control->deadline || now - start > (control->deadline - start) / 2) break;
+        }
+
+        MoveType move;
+        int16_t score = searchRoot<BoardType>(board, player, depth, bestscore, true, &move, stats, tt, control, options);
+        if (control && control->stopped()) break;
+
+        bestscore = score;
+        if (bestMoveRet) *bestMoveRet = move;
+        stats.depthReached = depth;
+    }
+
+    return bestscore;
+}
+
+// Lazy SMP driver. threads - 1 helper threads search the same root on their own copy of the board,
+// all sharing tt with the main thread. Helpers differ only through the random move order of the
+// board's move factory; what they store in tt is picked up by the main thread as cutoffs.
+// The main thread's result is returned, and helpers are stopped as soon as it has finished.
+// With iterative set the main thread deepens up to maxHalfMoveNum under control's deadline, otherwise
+// it searches maxHalfMoveNum directly through searchRoot, which takes expected as it is documented there.
+// tt entries are read and written without locking, see TTSlot for why a torn entry is harmless.
+template<typename BoardType>
+int16_t lazySmp(BoardType& board, player player, int maxHalfMoveNum, int16_t expected, bool hasExpected,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, transpositionTable& tt, unsigned threads,
+    bool iterative = false, searchControl* control = nullptr, const searchOptions& options = searchOptions()) {
+
+    searchControl helperControl;
+    if (control && control->hasDeadline) {
+        helperControl.hasDeadline = true;
+        helperControl.deadline = control->deadline;
+    }
+
+    // every helper gets its own copy of the board, made before any thread starts moving on the original
+    std::vector<BoardType> helperBoards(threads > 1 ? threads - 1 : 0, board);
+    std::vector<std::future<stat_t>> helpers;
+    for (unsigned t = 1; t < threads; ++t) {
+        helpers.push_back(std::async(std::launch::async, [&helperBoard = helperBoards[t - 1], player, maxHalfMoveNum, &tt, &helperControl, &options]() {
+            stat_t helperStats;
+            typename BoardType::MoveType move;
+            iterativeDeepening<BoardType>(helperBoard, player, maxHalfMoveNum, &move, helperStats, tt, &helperControl, options);
+            return helperStats;
+        }));
+    }
+
+    int16_t score;
+    if (iterative) {
+        score = iterativeDeepening<BoardType>(board, player, maxHalfMoveNum, bestMoveRet, stats, tt, control, options);
+    } else {
+        score = searchRoot<BoardType>(board, player, maxHalfMoveNum, expected, hasExpected, bestMoveRet, stats, tt, control, options);
+    }
+
+    helperControl.stop.store(true, std::memory_order_relaxed);
+
+    stats.nodesPerThread.assign(1, stats.nodesExplored);
+    for (auto& h : helpers) {
+        stat_t helperStats = h.get();
+        stats.nodesPerThread.push_back(helperStats.nodesExplored);
+        stats.nodesExplored += helperStats.nodesExplored;
+        stats.hashCollisions += helperStats.hashCollisions;
+    }
+
+    return score;
+}
+
+// Worker threads for ybwc, started once and reused by every split point.
+// idleThreads counts the workers not running a task. A split point claims some of them
+// and posts as many tasks, so every task posted has a worker free to run it.
+struct ybwcPool {
+    std::atomic<int> idleThreads;
+
+    explicit ybwcPool(unsigned threads) : idleThreads((int)threads - 1) {
+        for (unsigned t = 1; t < threads; ++t) workers.emplace_back([this]() { work(); });
+    }
+
+    ~ybwcPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closing = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    // takes up to wanted idle threads, returns how many were taken
+    int claim(int wanted) {
+        if (wanted <= 0) return 0;
+        int idle = idleThreads.load();
+        while (idle > 0) {
+            int take = std::min(idle, wanted);
+            if (idleThreads.compare_exchange_weak(idle, idle - take)) return take;
+        }
+        return 0;
+    }
+
+    // runs task on one of the claimed threads
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool closing = false;
+    std::vector<std::thread> workers;
+
+    void work() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this]() { return closing || !tasks.empty(); });
+            if (tasks.empty()) return;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            guard.unlock();
+            task();
+            idleThreads.fetch_add(1);
+            guard.lock();
+        }
+    }
+};
+
+
+// Young brothers wait parallel alpha-beta. Does not use a transposition table.
+// At every node the eldest child is searched first by the calling thread alone. Once its score is
+// known the remaining siblings from the move factory become a split point: the caller and any idle
+// threads from pool take siblings one at a time and search them on their own copy of the board,
+// with the best bounds found so far. A sibling that causes a cutoff raises the split point's stop
+// flag, which aborts every sibling search below it. Siblings may split again if threads are idle.
+// Nodes with fewer than minSplitDepth half moves left are searched serially by minimax.
+template<typename BoardType>
+int16_t ybwc(BoardType& board, player player, int halfMoveNum, int maxHalfMoveNum,
+    typename BoardType::MoveType* bestMoveRet, stat_t& stats, int16_t alpha, int16_t beta, typename BoardType::MoveType* lastMove,
+    ybwcPool& pool, int minSplitDepth, searchControl* control) {
+
+    using MoveType = typename BoardType::MoveType;
+    transpositionTable noTT;
+
+    if (maxHalfMoveNum - halfMoveNum < minSplitDepth) {
+        return minimax<BoardType>(board, player, halfMoveNum, maxHalfMoveNum, bestMoveRet, stats, alpha, beta, lastMove, noTT, control);
+    }
+
+    // split nodes are few and far apart, so they read the clock every time
+    uint64_t checkNow = 0;
+    if (control->shouldStop(stats.nodesExplored, checkNow)) return 0;
+
+    auto pwin = board.checkWin(lastMove);
+    if (pwin != player::NONE) {
+        return (pwin == player::A ? winScore(halfMoveNum) : -winScore(halfMoveNum));
+    }
+
+    bool maximizing = (player == player::A);
+    ::player next = maximizing ? player::B : player::A;
+
+    // returns true if score cuts off the remaining siblings
+    auto improves = [maximizing](int16_t score, int16_t& best, int16_t& alpha, int16_t& beta) {
+        if (maximizing) {
+            best = std::max(best, score);
+            alpha = std::max(alpha, best);
+            return alpha >= beta || isWinScore(score);
+        }
+        best = std::min(best, score);
+        beta = std::min(beta, best);
+        return beta <= alpha || isWinScore(-score);
+    };
+
+    auto moves = board.createMoveFactory(player);
+
+    // eldest brother, searched alone
+    MoveType first = moves.getNextBestMove();
+    if (!first.isValid()) return 0; // draw
+
+    #if statisticsEnabled
+    stats.nodesExplored++;
+    #endif
+    board.makeMove(first);
+    int16_t firstscore = ybwc<BoardType>(board, next, halfMoveNum+1, maxHalfMoveNum, nullptr, stats, alpha, beta, &first, pool, minSplitDepth, control);
+    board.undoMove(first);
+    if (control->stopped()) return firstscore;
+
+    int16_t bestscore = maximizing ? std::numeric_limits<int16_t>::min() : std::numeric_limits<int16_t>::max();
+    MoveType bestmove = first;
+    if (improves(firstscore, bestscore, alpha, beta)) {
+        if (bestMoveRet) *bestMoveRet = bestmove;
+        return bestscore;
+    }
+
+    // young brothers, searched in parallel
+    std::vector<MoveType> siblings;
+    for (MoveType m = moves.getNextBestMove(); m.isValid(); m = moves.getNextBestMove()) siblings.push_back(m);
+    if (siblings.empty()) {
+        if (bestMoveRet) *bestMoveRet = bestmove;
+        return bestscore;
+    }
+
+    std::mutex lock;
+    size_t nextSibling = 0;
+    searchControl splitControl(control);
+
+    auto worker = [&](BoardType& workerBoard, stat_t& workerStats) {
+        while (true) {
+            std::unique_lock<std::mutex> guard(lock);
+            if (nextSibling >= siblings.size() || splitControl.stopped()) return;
+            MoveType m = siblings[nextSibling++];
+            int16_t a = alpha, b = beta;
+            guard.unlock();
+
+            #if statisticsEnabled
+            workerStats.nodesExplored++;
+            #endif
+            workerBoard.makeMove(m);
+            int16_t newscore = ybwc<BoardType>(workerBoard, next, halfMoveNum+1, maxHalfMoveNum, nullptr, workerStats, a, b, &m, pool, minSplitDepth, &splitControl);
+            workerBoard.undoMove(m);
+            if (splitControl.stopped()) return;
+
+            guard.lock();
+            int16_t before = bestscore;
+            bool cutoff = improves(newscore, bestscore, alpha, beta);
+            if (bestscore != before) bestmove = m;
+            if (cutoff) splitControl.stop.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    int helpers = pool.claim((int)siblings.size() - 1);
+    std::vector<BoardType> helperBoards(helpers, board);
+    std::vector<stat_t> helperStats(helpers);
+    std::latch done(helpers);
+    for (int h = 0; h < helpers; ++h) {
+        pool.post([&, h]() {
+            worker(helperBoards[h], helperStats[h]);
+            done.count_down();
+        });
+    }
+    worker(board, stats);
+
+    done.wait();
+    for (const stat_t& workerStats : helperStats) stats.nodesExplored += workerStats.nodesExplored;
+
+    if (control->stopped()) return bestscore;
+    if (bestMoveRet) *bestMoveRet = bestmove;
+    return bestscore;
+}
+
+template<typename BoardType>
+int16_t ybwc(BoardType& board, player player, int maxHalfMoveNum, typename BoardType::MoveType* bestMoveRet,
+    stat_t& stats, unsigned threads, int minSplitDepth = 3) {
 
+    ybwcPool pool(threads);
+    searchControl control;
+    return ybwc<BoardType>(board, player, 0, maxHalfMoveNum, bestMoveRet, stats, -scoreInf, scoreInf,
+        (typename BoardType::MoveType*)nullptr, pool, minSplitDepth, &control);
 }
 }
@@ -547,15 +547,16 @@ public:
 
 class MinimaxAI_b5_v1 : public AI_base {
 public:
-    std::vector<mm5::TTEntry> tt;
+    mm5::transpositionTable tt;
 
     MinimaxAI_b5_v1() {
-        tt.resize((1024 * 1024 * 4 + sizeof(mm5::TTEntry)) / sizeof(mm5::TTEntry)); // 4MB + 1 ttentry 
+        tt.resize(1024 * 1024 * 4); // 4MB
     }
 
     evalReturn getNextMove(connect3dBoard board) override {
         b5_v1::connect3dBoardFast adapter(board);
         mm5::stat_t stats;
+        tt.newSearch();
         b5_v1::connect3dMoveFast bestMove;
         
         // Depth 4 provides a good balance of strength and speed for branching factor 16
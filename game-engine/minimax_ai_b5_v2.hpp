@@ -7,30 +7,262 @@
 #include <algorithm>
 #include <random>
 #include <utility>
+#include <span>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 namespace b5_v2 {
-struct ZobristKeys {
-    std::array<uint64_t, 64> piecesA;
-    std::array<uint64_t, 64> piecesB;
-    uint64_t sideToMove;
+// Lookup tables for the board. They are all generated at compile time, so the hot loops read flat
+// read only arrays with no first use guards.
+
+// the 76 winning lines, and the lines through each cell
+struct lineTable {
+    std::array<uint64_t, 76> masks{};
+    std::array<std::array<uint8_t, 7>, 64> cellLines{}; // indices into masks, cellLineCount of them are used
+    std::array<uint8_t, 64> cellLineCount{};
+    std::array<std::array<uint64_t, 7>, 64> cellMasks{}; // masks of the lines through each cell, padded with ~0
+
+    constexpr std::span<const uint8_t> linesThrough(int cell) const {
+        return {cellLines[cell].data(), cellLineCount[cell]};
+    }
+};
 
-    static const ZobristKeys& get() {
-        static ZobristKeys instance;
-        return instance;
+constexpr lineTable makeLineTable() {
+    lineTable t;
+    int count = 0;
+    auto addLine = [&](int i1, int i2, int i3, int i4) {
+        uint64_t m = (1ULL << i1) | (1ULL << i2) | (1ULL << i3) | (1ULL << i4);
+        t.masks[count] = m;
+        for (int i : {i1, i2, i3, i4}) t.cellLines[i][t.cellLineCount[i]++] = count;
+        count++;
+    };
+
+    // 1. Stacks (Vertical)
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            int i = r * 4 + c;
+            addLine(i, i + 16, i + 32, i + 48);
+        }
+    }
+    // 2. Rows (Horizontal along c)
+    for (int d = 0; d < 4; ++d) {
+        for (int r = 0; r < 4; ++r) {
+            int i = d * 16 + r * 4;
+            addLine(i, i + 1, i + 2, i + 3);
+        }
+    }
+    // 3. Columns (Horizontal along r)
+    for (int d = 0; d < 4; ++d) {
+        for (int c = 0; c < 4; ++c) {
+            int i = d * 16 + c;
+            addLine(i, i + 4, i + 8, i + 12);
+        }
+    }
+    // 4. Planar Diagonals
+    for (int d = 0; d < 4; ++d) {
+        int i = d * 16;
+        addLine(i, i + 5, i + 10, i + 15);
+        addLine(i + 3, i + 6, i + 9, i + 12);
+    }
+    // 5. Stairs (Vertical Diagonals)
+    for (int r = 0; r < 4; ++r) {
+        int i = r * 4;
+        addLine(i, i + 17, i + 34, i + 51);
+        addLine(i + 3, i + 18, i + 33, i + 48);
     }
+    for (int c = 0; c < 4; ++c) {
+        int i = c;
+        addLine(i, i + 20, i + 40, i + 60);
+        addLine(i + 12, i + 24, i + 36, i + 48);
+    }
+    // 6. Space Diagonals
+    addLine(0, 21, 42, 63);
+    addLine(3, 22, 41, 60);
+    addLine(12, 25, 38, 51);
+    addLine(15, 26, 37, 48);
+
+    for (int i = 0; i < 64; ++i) {
+        for (int k = 0; k < 7; ++k) t.cellMasks[i][k] = k < t.cellLineCount[i] ? t.masks[t.cellLines[i][k]] : ~0ULL;
+    }
+    return t;
+}
 
-private:
-    ZobristKeys() {
-        std::mt19937_64 rng(0x123456789ABCDEF);
-        std::uniform_int_distribution<uint64_t> dist;
-        for (int i = 0; i < 64; ++i) {
-            piecesA[i] = dist(rng);
-            piecesB[i] = dist(rng);
+inline constexpr lineTable lineLookup = makeLineTable();
+
+// heuristic value of a line holding cntA pieces of player A and cntB of player B, positive for A
+constexpr int16_t scoreFromCounts(int cntA, int cntB) {
+    if (cntA > 0 && cntB > 0) return 0;
+    if (cntA == 0 && cntB == 0) return 0;
+    
+    int k = (cntA > 0) ? cntA : cntB;
+    int16_t v = 0;
+    if (k == 1) v = 1;
+    else if (k == 2) v = 10;
+    else if (k == 3) v = 100;
+    else if (k >= 4) v = 10000;
+
+    return (cntA > 0) ? v : -v;
+}
+
+// The board keeps the occupancy of every line as a state, cntA + 5 * cntB.
+// A piece adds lineStateStep[mover] to the states of its lines.
+inline constexpr std::array<uint8_t, 2> lineStateStep = {1, 5}; // player A, player B
+constexpr int lineStates = 25;
+
+struct lineScoreTable {
+    std::array<int16_t, lineStates> score{}; // scoreFromCounts of each state
+    std::array<std::array<int16_t, 2>, lineStates> delta{}; // score change when A (0) or B (1) adds a piece
+};
+
+constexpr lineScoreTable makeLineScoreTable() {
+    lineScoreTable t;
+    for (int a = 0; a <= 4; ++a) {
+        for (int b = 0; a + b <= 4; ++b) {
+            int state = a + 5 * b;
+            t.score[state] = scoreFromCounts(a, b);
+            if (a + b < 4) {
+                t.delta[state][0] = scoreFromCounts(a + 1, b) - scoreFromCounts(a, b);
+                t.delta[state][1] = scoreFromCounts(a, b + 1) - scoreFromCounts(a, b);
+            }
         }
-        sideToMove = dist(rng);
     }
+    return t;
+}
+
+inline constexpr lineScoreTable lineScores = makeLineScoreTable();
+
+// Smallest heuristic gain of a move that makes or blocks a three: turning a line of two into a three.
+// Any other line gains the mover at most 10 (taking a two away from the opponent), so even a move
+// through the most lines, 7, gains less without making or blocking a three.
+inline constexpr int16_t threeDelta = lineScores.delta[2 * lineStateStep[0]][0];
+static_assert(threeDelta > 7 * 10, "a three must outweigh the smaller gains of every line through a cell");
+
+// symmetryTable[s][i] is where symmetry s moves cell i
+constexpr std::array<std::array<int, 64>, 8> makeSymmetryTable() {
+    std::array<std::array<int, 64>, 8> t{};
+    for (int z = 0; z < 4; ++z) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                int i = z * 16 + r * 4 + c;
+                t[0][i] = i;
+                t[1][i] = z * 16 + c * 4 + (3 - r);
+                t[2][i] = z * 16 + (3 - r) * 4 + (3 - c);
+                t[3][i] = z * 16 + (3 - c) * 4 + r;
+                t[4][i] = z * 16 + r * 4 + (3 - c);
+                t[5][i] = z * 16 + (3 - r) * 4 + c;
+                t[6][i] = z * 16 + c * 4 + r;
+                t[7][i] = z * 16 + (3 - c) * 4 + (3 - r);
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr std::array<std::array<int, 64>, 8> symmetryTable = makeSymmetryTable();
+
+// inverseSymmetryTable[s][i] is the cell symmetry s moves to i
+constexpr std::array<std::array<int, 64>, 8> makeInverseSymmetryTable() {
+    std::array<std::array<int, 64>, 8> t{};
+    for (int s = 0; s < 8; ++s) {
+        for (int i = 0; i < 64; ++i) t[s][symmetryTable[s][i]] = i;
+    }
+    return t;
+}
+
+inline constexpr std::array<std::array<int, 64>, 8> inverseSymmetryTable = makeInverseSymmetryTable();
+
+struct ZobristKeys {
+    std::array<uint64_t, 64> piecesA{};
+    std::array<uint64_t, 64> piecesB{};
+    uint64_t sideToMove = 0;
+
+    // Keys of a piece on a cell for each of the 8 symmetric hashes, with the side to move change
+    // folded in, so a move updates all 8 hashes with one 8 lane XOR.
+    // movesA[i][s] = piecesA[symmetryTable[s][i]] ^ sideToMove
+    alignas(64) std::array<std::array<uint64_t, 8>, 64> movesA{};
+    alignas(64) std::array<std::array<uint64_t, 8>, 64> movesB{};
 };
 
+// keys from a splitmix64 sequence, which is simple enough to run at compile time
+constexpr ZobristKeys makeZobristKeys() {
+    ZobristKeys k;
+    uint64_t state = 0x123456789ABCDEF;
+    auto next = [&]() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    };
+    for (int i = 0; i < 64; ++i) {
+        k.piecesA[i] = next();
+        k.piecesB[i] = next();
+    }
+    k.sideToMove = next();
+    for (int i = 0; i < 64; ++i) {
+        for (int s = 0; s < 8; ++s) {
+            k.movesA[i][s] = k.piecesA[symmetryTable[s][i]] ^ k.sideToMove;
+            k.movesB[i][s] = k.piecesB[symmetryTable[s][i]] ^ k.sideToMove;
+        }
+    }
+    return k;
+}
+
+inline constexpr ZobristKeys zobristKeys = makeZobristKeys();
+
+// hashes[s] ^= keys[s] for all 8 lanes
+inline void xorHashes(std::array<uint64_t, 8>& hashes, const std::array<uint64_t, 8>& keys) {
+#if defined(__AVX512F__)
+    __m512i h = _mm512_load_si512(hashes.data());
+    _mm512_store_si512(hashes.data(), _mm512_xor_si512(h, _mm512_load_si512(keys.data())));
+#elif defined(__AVX2__)
+    for (int i = 0; i < 8; i += 4) {
+        __m256i h = _mm256_load_si256((const __m256i*)&hashes[i]);
+        _mm256_store_si256((__m256i*)&hashes[i], _mm256_xor_si256(h, _mm256_load_si256((const __m256i*)&keys[i])));
+    }
+#else
+    for (int s = 0; s < 8; ++s) hashes[s] ^= keys[s];
+#endif
+}
+
+// smallest of the 8 hashes
+inline uint64_t minHash(const std::array<uint64_t, 8>& hashes) {
+#if defined(__AVX512VL__)
+    __m256i m = _mm256_min_epu64(_mm256_load_si256((const __m256i*)&hashes[0]), _mm256_load_si256((const __m256i*)&hashes[4]));
+    m = _mm256_min_epu64(m, _mm256_permute4x64_epi64(m, 0x4E)); // swap 128 bit halves
+    m = _mm256_min_epu64(m, _mm256_shuffle_epi32(m, 0x4E)); // swap 64 bit lanes
+    return (uint64_t)_mm256_extract_epi64(m, 0);
+#elif defined(__AVX2__)
+    // AVX2 only compares signed 64 bit lanes, so flip the sign bits to compare unsigned
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    __m256i a = _mm256_xor_si256(_mm256_load_si256((const __m256i*)&hashes[0]), sign);
+    __m256i b = _mm256_xor_si256(_mm256_load_si256((const __m256i*)&hashes[4]), sign);
+    __m256i m = _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+    __m256i sw = _mm256_permute4x64_epi64(m, 0x4E); // swap 128 bit halves
+    m = _mm256_blendv_epi8(m, sw, _mm256_cmpgt_epi64(m, sw));
+    sw = _mm256_shuffle_epi32(m, 0x4E); // swap 64 bit lanes
+    m = _mm256_blendv_epi8(m, sw, _mm256_cmpgt_epi64(m, sw));
+    return (uint64_t)_mm256_extract_epi64(m, 0) ^ 0x8000000000000000ULL;
+#else
+    uint64_t m = hashes[0];
+    for (int i = 1; i < 8; ++i) if (hashes[i] < m) m = hashes[i];
+    return m;
+#endif
+}
+
+// Sorts 16 keys into descending order without branches: each key goes to the place given by the
+// number of keys greater than it. Keys must be distinct, apart from zeros, which pad the array and end up last.
+// Both loops have a fixed trip count, so the compiler turns the counting into vector compares.
+inline void sortKeysDescending(std::array<uint32_t, 16>& keys) {
+    std::array<uint32_t, 16> sorted = {};
+    for (int i = 0; i < 16; ++i) {
+        int rank = 0;
+        for (int j = 0; j < 16; ++j) rank += keys[j] > keys[i];
+        sorted[rank] = keys[i];
+    }
+    keys = sorted;
+}
+
 // A fast variant of connect3dMove for AI use
 struct connect3dMoveFast {
     uint8_t movenum;
@@ -53,7 +285,7 @@ struct connect3dMoveFast {
 };
 
 // A fast game board using bitboards for AI use
-struct connect3dBoardFast : public mm5::board_t<connect3dMoveFast>{
+struct connect3dBoardFast final : public mm5::board_t<connect3dMoveFast>{
     using MoveType = connect3dMoveFast;
 
     /* 
@@ -86,171 +318,173 @@ struct connect3dBoardFast : public mm5::board_t<connect3dMoveFast>{
     uint64_t boardA = 0;
     uint64_t boardB = 0;
     player playerTurn = player::A;
-    std::array<uint64_t, 8> zHashes;
+    std::array<uint8_t, 16> heights = {}; // pieces in each column, the layer the next piece there lands on
+    alignas(64) std::array<uint64_t, 8> zHashes; // hash of each of the 8 symmetries of the position
 
     int32_t currentScore = 0;
-
+    std::array<uint8_t, 76> lineState = {}; // occupancy of each line, see lineStateStep
+
+    // Threat cells: empty cells that complete a line of four for a player (index 0 A, 1 B), whether or not
+    // they are playable yet. threatLines counts the lines each cell completes, the bitboards are its nonzero cells.
+    std::array<uint64_t, 2> threats = {};
+    std::array<std::array<uint8_t, 64>, 2> threatLines = {};
+    // the cell each column's next piece lands on, for columns that aren't full
+    uint64_t playable = 0xFFFF;
+
+    // Generates moves in stages, so that a cutoff early on saves the work of the later stages:
+    // the move to try first (the TT move), then wins and blocks, then the killers,
+    // and only then the remaining quiet moves, scored by their heuristic delta and history.
     struct MoveFactory {
         connect3dBoardFast* board = nullptr;
-        std::array<connect3dMoveFast, 16> moves;
+        std::array<uint8_t, 16> columns; // the legal moves, in random order so that ties are broken at random
         int count = 0;
         int idx = 0;
-        bool heuristicCalculated = false;
+        mm5::MoveStage current = mm5::STAGE_TT_MOVE; // stage of the move returned last
+        mm5::MoveStage next = mm5::STAGE_TT_MOVE; // stage to take the next move from
+        uint16_t returned = 0; // columns already returned by an earlier stage
+
+        // killer and history tables, if the search keeps them
+        const mm5::orderingTables* ordering = nullptr;
+        int ply = 0;
+        int prevColumn = -1;
+        // Quiet moves as packed sort keys, (score + 1) << 8 | tiebreak << 4 | column, best first once sorted.
+        // The score is the heuristic delta with history breaking ties, the tiebreak the move's place in columns.
+        std::array<uint32_t, 16> keys = {};
+        std::array<int16_t, 16> deltas = {}; // heuristic delta of each quiet move, by column
+
+        // a move to try before the rest, such as the transposition table's best move
+        connect3dMoveFast firstMove;
+
+        // sets the move returned first, if it is one of the legal moves
+        void setFirstMove(const connect3dMoveFast& m) {
+            for (int i = 0; i < count; ++i) {
+                if (columns[i] == m.movenum) firstMove = m;
+            }
+        }
+
+        // stage of the move returned last, for the search's statistics
+        mm5::MoveStage stage() const { return current; }
 
-        // gets next best move by heuristic
+        // gets the next move, from the earliest stage that has one left
         // returns an invalid move if no moves left
         connect3dMoveFast getNextBestMove() {
-            if (idx >= count) return connect3dMoveFast();
-
-            // Move ordering: 
-            // calculate heuristics of each move
-            // then swap best to front
-            if (!heuristicCalculated && board) {
-                int16_t initH = board->heuristic();
-                player p = board->playerTurn;
-                int16_t multiplier = (p == player::A) ? 1 : -1;
-                for (int i = 0; i < count; ++i) {
-                    board->makeMove(moves[i]);
-                    int16_t diff = board->heuristic() - initH;
-                    moves[i].deltaHeuristic = diff * multiplier;
-                    moves[i].hasHeuristic = true;
-                    board->undoMove(moves[i]);
+            switch (next) {
+            case mm5::STAGE_TT_MOVE:
+                next = mm5::STAGE_FORCING;
+                if (firstMove.isValid()) return take(firstMove.movenum, mm5::STAGE_TT_MOVE);
+                [[fallthrough]];
+            case mm5::STAGE_FORCING:
+                if (current != mm5::STAGE_FORCING) {
+                    mm5::forcingMoves_t forcing = board->forcingMoves(board->playerTurn);
+                    wins = forcing.wins & ~returned;
+                    blocks = forcing.blocks & ~returned & ~wins;
+                    current = mm5::STAGE_FORCING;
                 }
-                heuristicCalculated = true;
-            }
-
-            // swap best move to front
-            int bestIdx = idx;
-            for (int i = idx + 1; i < count; ++i) {
-                if (moves[i].deltaHeuristic > moves[bestIdx].deltaHeuristic) {
-                    bestIdx = i;
+                if (wins) return take(popColumn(wins), mm5::STAGE_FORCING);
+                if (blocks) return take(popColumn(blocks), mm5::STAGE_FORCING);
+                next = mm5::STAGE_KILLERS;
+                [[fallthrough]];
+            case mm5::STAGE_KILLERS:
+                // a killer that doesn't make or block a three is left to the quiet moves, which the heuristic orders better
+                if (ordering && ply < mm5::orderingTables::maxPly) {
+                    while (killerIdx < 2) {
+                        uint8_t killer = ordering->killers[ply][killerIdx++];
+                        if (killer < 16 && board->heights[killer] < 4 && !(returned >> killer & 1)
+                            && board->moveDelta(connect3dMoveFast(killer)) >= threeDelta) return take(killer, mm5::STAGE_KILLERS);
+                    }
                 }
+                next = mm5::STAGE_QUIET;
+                scoreQuiet();
+                [[fallthrough]];
+            case mm5::STAGE_QUIET:
+            default:
+                break;
             }
-            if (bestIdx != idx) {
-                std::swap(moves[idx], moves[bestIdx]);
+
+            current = mm5::STAGE_QUIET;
+            if (idx >= count) return connect3dMoveFast();
+
+            connect3dMoveFast m(keys[idx++] & 15);
+            m.deltaHeuristic = deltas[m.movenum];
+            m.hasHeuristic = true;
+            return m;
+        }
+
+    private:
+        uint16_t wins = 0; // wins and blocks still to return from the forcing stage
+        uint16_t blocks = 0;
+        int killerIdx = 0;
+
+        static int popColumn(uint16_t& columns) {
+            int c = std::countr_zero(columns);
+            columns &= columns - 1;
+            return c;
+        }
+
+        // returns column c from stage s, scored so the search can judge it like any other move
+        connect3dMoveFast take(int c, mm5::MoveStage s) {
+            current = s;
+            returned |= 1u << c;
+            connect3dMoveFast m(c);
+            m.deltaHeuristic = board->moveDelta(m);
+            m.hasHeuristic = true;
+            return m;
+        }
+
+        // drops the moves returned by earlier stages, scores the rest without playing them and sorts them
+        void scoreQuiet() {
+            int quiet = 0;
+            for (int i = 0; i < count; ++i) {
+                int c = columns[i];
+                if (returned >> c & 1) continue;
+                connect3dMoveFast m(c);
+                int32_t history = (ordering && prevColumn >= 0) ? ordering->history[prevColumn][board->moveCell(m)] : 0;
+                deltas[c] = board->moveDelta(m);
+                // quiet deltas stay in the hundreds, the clamp only keeps the key in 31 bits
+                uint32_t score = (std::clamp<int32_t>(deltas[c], 0, 8191) << 10) + std::min(history, 1023);
+                keys[quiet++] = ((score + 1) << 8) | ((15 - i) << 4) | c;
             }
-            return moves[idx++];
+            count = quiet;
+            sortKeysDescending(keys);
         }
     };
 
     connect3dBoardFast() : boardA(0), boardB(0) { zHashes.fill(0); }
 
-    // Static lookup table for winning lines and cell-to-line mapping
-    static const std::pair<std::vector<uint64_t>, std::vector<std::vector<int>>>& getLookup() {
-        static const auto data = []() {
-            std::vector<uint64_t> masks;
-            std::vector<std::vector<int>> cellLines(64);
-            
-            auto addLine = [&](int i1, int i2, int i3, int i4) {
-                int idx = masks.size();
-                uint64_t m = (1ULL << i1) | (1ULL << i2) | (1ULL << i3) | (1ULL << i4);
-                masks.push_back(m);
-                cellLines[i1].push_back(idx);
-                cellLines[i2].push_back(idx);
-                cellLines[i3].push_back(idx);
-                cellLines[i4].push_back(idx);
-            };
-
-            // 1. Stacks (Vertical)
-            for (int r = 0; r < 4; ++r) {
-                for (int c = 0; c < 4; ++c) {
-                    int i = r * 4 + c;
-                    addLine(i, i + 16, i + 32, i + 48);
-                }
-            }
-            // 2. Rows (Horizontal along c)
-            for (int d = 0; d < 4; ++d) {
-                for (int r = 0; r < 4; ++r) {
-                    int i = d * 16 + r * 4;
-                    addLine(i, i + 1, i + 2, i + 3);
-                }
-            }
-            // 3. Columns (Horizontal along r)
-            for (int d = 0; d < 4; ++d) {
-                for (int c = 0; c < 4; ++c) {
-                    int i = d * 16 + c;
-                    addLine(i, i + 4, i + 8, i + 12);
-                }
-            }
-            // 4. Planar Diagonals
-            for (int d = 0; d < 4; ++d) {
-                int i = d * 16;
-                addLine(i, i + 5, i + 10, i + 15);
-                addLine(i + 3, i + 6, i + 9, i + 12);
-            }
-            // 5. Stairs (Vertical Diagonals)
-            for (int r = 0; r < 4; ++r) {
-                int i = r * 4;
-                addLine(i, i + 17, i + 34, i + 51);
-                addLine(i + 3, i + 18, i + 33, i + 48);
-            }
-            for (int c = 0; c < 4; ++c) {
-                int i = c;
-                addLine(i, i + 20, i + 40, i + 60);
-                addLine(i + 12, i + 24, i + 36, i + 48);
-            }
-            // 6. Space Diagonals
-            addLine(0, 21, 42, 63);
-            addLine(3, 22, 41, 60);
-            addLine(12, 25, 38, 51);
-            addLine(15, 26, 37, 48);
-
-            return std::make_pair(masks, cellLines);
-        }();
-        return data;
-    }
-
-    // Static lookup table for symmetries
-    static const std::array<std::array<int, 64>, 8>& getSymmetryTable() {
-        static const auto table = []() {
-            std::array<std::array<int, 64>, 8> t;
-            for (int z = 0; z < 4; ++z) {
-                for (int r = 0; r < 4; ++r) {
-                    for (int c = 0; c < 4; ++c) {
-                        int i = z * 16 + r * 4 + c;
-                        t[0][i] = i;
-                        t[1][i] = z * 16 + c * 4 + (3 - r);
-                        t[2][i] = z * 16 + (3 - r) * 4 + (3 - c);
-                        t[3][i] = z * 16 + (3 - c) * 4 + r;
-                        t[4][i] = z * 16 + r * 4 + (3 - c);
-                        t[5][i] = z * 16 + (3 - r) * 4 + c;
-                        t[6][i] = z * 16 + c * 4 + r;
-                        t[7][i] = z * 16 + (3 - c) * 4 + (3 - r);
-                    }
-                }
-            }
-            return t;
-        }();
-        return table;
+    // line states of a line with 3 pieces of one player and none of the other
+    static constexpr uint8_t threatState[2] = {3 * lineStateStep[0], 3 * lineStateStep[1]};
+    static constexpr uint32_t threatStates = (1u << threatState[0]) | (1u << threatState[1]); // as a set, for a quick skip
+
+    void addThreat(int side, int cell) {
+        if (threatLines[side][cell]++ == 0) threats[side] |= 1ULL << cell;
     }
 
-    static inline int16_t scoreFromCounts(int cntA, int cntB) {
-        if (cntA > 0 && cntB > 0) return 0;
-        if (cntA == 0 && cntB == 0) return 0;
-        
-        int k = (cntA > 0) ? cntA : cntB;
-        int16_t v = 0;
-        if (k == 1) v = 1;
-        else if (k == 2) v = 10;
-        else if (k == 3) v = 100;
-        else if (k >= 4) v = 10000;
+    void removeThreat(int side, int cell) {
+        if (--threatLines[side][cell] == 0) threats[side] &= ~(1ULL << cell);
+    }
 
-        return (cntA > 0) ? v : -v;
+    static constexpr const std::array<std::array<int, 64>, 8>& getSymmetryTable() { return symmetryTable; }
+
+    // score change, positive for A, of player p placing a piece on cell
+    int16_t cellDelta(int cell, player p) const {
+        int side = p == player::A ? 0 : 1;
+        int16_t delta = 0;
+        for (int lineIdx : lineLookup.linesThrough(cell)) delta += lineScores.delta[lineState[lineIdx]][side];
+        return delta;
     }
 
-    // Calculate score for a specific line based on current board state
-    int16_t getLineScore(int lineIdx) const {
-        uint64_t mask = getLookup().first[lineIdx];
-        int cntA = std::popcount(boardA & mask);
-        int cntB = std::popcount(boardB & mask);
-        return scoreFromCounts(cntA, cntB);
+    // heuristic gain for the side to move of playing m, without playing it
+    int16_t moveDelta(const connect3dMoveFast& m) const {
+        int16_t delta = cellDelta(moveCell(m), playerTurn);
+        return playerTurn == player::A ? delta : -delta;
     }
 
     connect3dBoardFast(const connect3dBoard& b) {
         zHashes.fill(0);
-        const auto& keys = ZobristKeys::get();
-        const auto& sym = getSymmetryTable();
+        const auto& keys = zobristKeys;
+        const auto& sym = symmetryTable;
         for (int i = 0; i < 64; ++i) {
+            if (b.board[i] != player::NONE) heights[i & 15]++;
             if (b.board[i] == player::A) {
                 boardA |= (1ULL << i);
                 for(int s=0; s<8; ++s) zHashes[s] ^= keys.piecesA[sym[s][i]];
@@ -264,28 +498,28 @@ struct connect3dBoardFast : public mm5::board_t<connect3dMoveFast>{
         if (playerTurn == player::B) for(int s=0; s<8; ++s) zHashes[s] ^= keys.sideToMove;
         
         currentScore = 0;
-        // Initialize score by summing up all lines
-        const auto& masks = getLookup().first;
-        for (size_t i = 0; i < masks.size(); ++i) {
-            currentScore += getLineScore(i);
+        // Initialize line states and the score by summing up all lines
+        for (size_t i = 0; i < lineLookup.masks.size(); ++i) {
+            uint64_t mask = lineLookup.masks[i];
+            lineState[i] = std::popcount(boardA & mask) * lineStateStep[0] + std::popcount(boardB & mask) * lineStateStep[1];
+            currentScore += lineScores.score[lineState[i]];
+            for (int side = 0; side < 2; ++side) {
+                if (lineState[i] == threatState[side]) addThreat(side, std::countr_zero(mask & ~(boardA | boardB)));
+            }
         }
+        playable = 0;
+        for (int c = 0; c < 16; ++c) if (heights[c] < 4) playable |= 1ULL << (c + (heights[c] << 4));
     }
 
     inline bool isMoveLegal(const connect3dMoveFast& m) const {
-        // Move is legal if top layer is empty in move spot
-        uint64_t moveMask = (uint64_t)connect3dMoveFast::getMask(m) << 48;
-        return !((boardA | boardB) & moveMask);
+        return heights[m.movenum] < 4;
     }
 
     void makeMove(connect3dMoveFast m) override {
-        uint64_t moveMask = connect3dMoveFast::getMask(m);
-        uint64_t filled = boardA | boardB;
-        int layer = 0;
-        while (filled & moveMask) {
-            // move up a layer
-            moveMask <<= 16;
-            layer++;
-        }
+        int layer = heights[m.movenum]++;
+        uint64_t moveMask = (uint64_t)connect3dMoveFast::getMask(m) << (layer << 4);
+        int idx = m.movenum + (layer << 4);
+        int side = playerTurn == player::A ? 0 : 1;
         
         if (m.hasHeuristic) {
             // deltaHeuristic is the improvement for the mover (always positive for a good move).
@@ -294,252 +528,264 @@ struct connect3dBoardFast : public mm5::board_t<connect3dMoveFast>{
             int16_t diff = (playerTurn == player::A) ? m.deltaHeuristic : -m.deltaHeuristic;
             currentScore += diff;
         } else {
-            int idx = m.movenum + (layer << 4);
-            const auto& lines = getLookup().second[idx];
-            
-            // Subtract score of affected lines before the move
-            for (int lineIdx : lines) {
-                currentScore -= getLineScore(lineIdx);
-            }
+            currentScore += cellDelta(idx, playerTurn);
         }
 
-        int idx = m.movenum + (layer << 4);
-        const auto& keys = ZobristKeys::get();
-        const auto& sym = getSymmetryTable();
+        const auto& keys = zobristKeys;
 
         if (playerTurn == player::A) {
             boardA |= moveMask;
-            for(int s=0; s<8; ++s) zHashes[s] ^= keys.piecesA[sym[s][idx]];
+            xorHashes(zHashes, keys.movesA[idx]);
         } else {
             boardB |= moveMask;
-            for(int s=0; s<8; ++s) zHashes[s] ^= keys.piecesB[sym[s][idx]];
+            xorHashes(zHashes, keys.movesB[idx]);
         }
-        for(int s=0; s<8; ++s) zHashes[s] ^= keys.sideToMove;
-        playerTurn = (playerTurn == player::A) ? player::B : player::A;
 
-        if (!m.hasHeuristic) {
-            int idx = m.movenum + (layer << 4);
-            const auto& lines = getLookup().second[idx];
-            // Add score of affected lines after the move
-            for (int lineIdx : lines) {
-                currentScore += getLineScore(lineIdx);
-            }
+        // Update the lines through the cell. A threat line through it had this cell as its empty cell,
+        // and a line the mover now has 3 of is a threat on its remaining empty cell.
+        uint64_t filled = boardA | boardB;
+        for (int lineIdx : lineLookup.linesThrough(idx)) {
+            uint8_t before = lineState[lineIdx];
+            uint8_t after = lineState[lineIdx] += lineStateStep[side];
+            if (!(((threatStates >> before) | (threatStates >> after)) & 1)) continue;
+            if (before == threatState[side ^ 1]) removeThreat(side ^ 1, idx);
+            else if (before == threatState[side]) removeThreat(side, idx);
+            if (after == threatState[side]) addThreat(side, std::countr_zero(lineLookup.masks[lineIdx] & ~filled));
         }
+        playable &= ~moveMask;
+        if (layer < 3) playable |= moveMask << 16;
+
+        playerTurn = (playerTurn == player::A) ? player::B : player::A;
     }
 
     void undoMove(connect3dMoveFast m) override {
-        uint64_t moveMask = (uint64_t)connect3dMoveFast::getMask(m) << 48;
-        uint64_t empty = (~boardA) & (~boardB);
-        int layer = 3;
-        while (empty & moveMask) {
-            // move down a layer
-            moveMask >>= 16;
-            layer--;
-        }
-        
-        if (m.hasHeuristic) {
-            // Undo the score change. 
-            // Note: playerTurn here is the opponent of the one who made the move (before we flip it back).
-            int16_t diff = (playerTurn == player::B) ? m.deltaHeuristic : -m.deltaHeuristic;
-            currentScore -= diff;
-        } else {
-            int idx = m.movenum + (layer << 4);
-            const auto& lines = getLookup().second[idx];
-
-            // Subtract score of affected lines before undoing
-            for (int lineIdx : lines) {
-                currentScore -= getLineScore(lineIdx);
-            }
-        }
+        int layer = --heights[m.movenum];
+        uint64_t moveMask = (uint64_t)connect3dMoveFast::getMask(m) << (layer << 4);
+        int idx = m.movenum + (layer << 4);
 
-        const auto& keys = ZobristKeys::get();
-        const auto& sym = getSymmetryTable();
-        for(int s=0; s<8; ++s) zHashes[s] ^= keys.sideToMove;
+        const auto& keys = zobristKeys;
         playerTurn = (playerTurn == player::A) ? player::B : player::A;
-        
-        int idx = m.movenum + (layer << 4);
+        int side = playerTurn == player::A ? 0 : 1;
+
+        // the reverse of makeMove, while the piece is still on the board
+        uint64_t filled = boardA | boardB;
+        for (int lineIdx : lineLookup.linesThrough(idx)) {
+            uint8_t before = lineState[lineIdx];
+            uint8_t after = lineState[lineIdx] -= lineStateStep[side];
+            if (!(((threatStates >> before) | (threatStates >> after)) & 1)) continue;
+            if (before == threatState[side]) removeThreat(side, std::countr_zero(lineLookup.masks[lineIdx] & ~filled));
+            if (after == threatState[side ^ 1]) addThreat(side ^ 1, idx);
+            else if (after == threatState[side]) addThreat(side, idx);
+        }
+        if (layer < 3) playable &= ~(moveMask << 16);
+        playable |= moveMask;
 
         if (playerTurn == player::A) {
             boardA &= ~moveMask;
-            for(int s=0; s<8; ++s) zHashes[s] ^= keys.piecesA[sym[s][idx]];
+            xorHashes(zHashes, keys.movesA[idx]);
         } else {
             boardB &= ~moveMask;
-            for(int s=0; s<8; ++s) zHashes[s] ^= keys.piecesB[sym[s][idx]];
+            xorHashes(zHashes, keys.movesB[idx]);
         }
 
-        if (!m.hasHeuristic) {
-            int idx = m.movenum + (layer << 4);
-            const auto& lines = getLookup().second[idx];
-            // Add score of affected lines after undoing (restoring previous state)
-            for (int lineIdx : lines) {
-                currentScore += getLineScore(lineIdx);
-            }
+        if (m.hasHeuristic) {
+            // Undo the score change. playerTurn is back to the player who made the move.
+            int16_t diff = (playerTurn == player::A) ? m.deltaHeuristic : -m.deltaHeuristic;
+            currentScore -= diff;
+        } else {
+            currentScore -= cellDelta(idx, playerTurn);
         }
     }
 
     player checkWin(connect3dMoveFast* m) const override {
         if (m && m->isValid()) {
             int col = m->movenum;
-            uint64_t all = boardA | boardB;
-            int z = 0;
-            
-            // Find the z-level of the piece just placed (topmost in column)
-            if ((all >> 48) & (1ULL << col)) z = 3;
-            else if ((all >> 32) & (1ULL << col)) z = 2;
-            else if ((all >> 16) & (1ULL << col)) z = 1;
-            
-            int y = (col >> 2) & 3;
-            int x = col & 3;
-
+            int z = heights[col] - 1; // the piece just placed is the top of its column
             uint64_t playerBoard = (playerTurn == player::A) ? boardB : boardA; // reversed because last move was opposite player
 
-            static constexpr int dirs[13][3] = {
-                {1,0,0}, {0,1,0}, {0,0,1}, 
-                {1,1,0}, {1,-1,0}, {1,0,1}, {1,0,-1}, {0,1,1}, {0,1,-1}, 
-                {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1}
-            };
-
-            for (const auto& d : dirs) {
-                int count = 1;
-                // Positive direction
-                for (int k = 1; k < 4; ++k) {
-                    int nx = x + k*d[0];
-                    int ny = y + k*d[1];
-                    int nz = z + k*d[2];
-                    if (nx >= 0 && nx < 4 && ny >= 0 && ny < 4 && nz >= 0 && nz < 4) {
-                        if (playerBoard & (1ULL << (nz*16 + ny*4 + nx))) count++;
-                        else break;
-                    } else break;
-                }
-                // Negative direction
-                for (int k = 1; k < 4; ++k) {
-                    int nx = x - k*d[0];
-                    int ny = y - k*d[1];
-                    int nz = z - k*d[2];
-                    if (nx >= 0 && nx < 4 && ny >= 0 && ny < 4 && nz >= 0 && nz < 4) {
-                        if (playerBoard & (1ULL << (nz*16 + ny*4 + nx))) count++;
-                        else break;
-                    } else break;
-                }
-                
-                if (count >= 4) return (playerTurn == player::A) ? player::B : player::A;
-            }
+            // the lines through the placed cell, padded with full masks that can never be filled
+            bool won = false;
+            for (uint64_t mask : lineLookup.cellMasks[z * 16 + col]) won |= (playerBoard & mask) == mask;
+            if (won) return (playerTurn == player::A) ? player::B : player::A;
         }
 
         return player::NONE;
     }
 
     MoveFactory createMoveFactory(player p) {
-        uint64_t boards = boardA | boardB;
         MoveFactory factory;
         factory.board = this;
 
         int numMoves = 0;
 
         for (int i = 0; i < 16; i++) {
-            if (!((boards >> (i + 48)) & 1)) {
-                factory.moves[numMoves++] = connect3dMoveFast(i);
+            if (heights[i] < 4) {
+                factory.columns[numMoves++] = i;
             }
         }
         factory.count = numMoves;
 
         static thread_local std::mt19937 g(std::random_device{}());
-        std::shuffle(factory.moves.begin(), factory.moves.begin() + numMoves, g);
+        std::shuffle(factory.columns.begin(), factory.columns.begin() + numMoves, g);
+
+        return factory;
+    }
 
+    // move factory that also orders by the search's killer and history tables
+    MoveFactory createMoveFactory(player p, const mm5::orderingTables* ordering, int ply, int prevColumn) {
+        MoveFactory factory = createMoveFactory(p);
+        factory.ordering = ordering;
+        factory.ply = ply;
+        factory.prevColumn = prevColumn;
         return factory;
     }
 
+    uint64_t playableCells() const { return playable; }
+
+    // empty cells that would complete a line of four for p, playable or not
+    uint64_t threatCells(player p) const { return threats[p == player::A ? 0 : 1]; }
+
+    // columns, as a bitmask, where p completes a line of four with the next piece
+    uint16_t winningColumns(player p) const {
+        uint64_t cells = threatCells(p) & playable;
+        return (uint16_t)(cells | (cells >> 16) | (cells >> 32) | (cells >> 48));
+    }
+
+    // forcing moves for player p, as bitmasks of columns. wins are playable cells that complete a line
+    // of four for p, blocks are playable cells that would complete one for the opponent.
+    mm5::forcingMoves_t forcingMoves(player p) const {
+        return {winningColumns(p), winningColumns(p == player::A ? player::B : player::A)};
+    }
+
+    // m judged without playing it, for a node one half move from the depth limit. The reply is forcing
+    // if after m either player has a threat on a playable cell: the threats m makes and the cell above it
+    // are the only ones that can be new.
+    mm5::frontierMove_t frontierMove(const connect3dMoveFast& m) const {
+        int cell = moveCell(m);
+        int side = playerTurn == player::A ? 0 : 1;
+        uint64_t bit = 1ULL << cell;
+        if (threats[side] & bit) return {true, false, 0};
+
+        uint64_t filled = boardA | boardB | bit;
+        uint64_t nextPlayable = (playable & ~bit) | (bit << 16);
+        uint64_t ownThreats = threats[side];
+        int32_t score = currentScore;
+        for (int lineIdx : lineLookup.linesThrough(cell)) {
+            uint8_t state = lineState[lineIdx];
+            score += lineScores.delta[state][side];
+            if (state + lineStateStep[side] == threatState[side]) ownThreats |= lineLookup.masks[lineIdx] & ~filled;
+        }
+        bool forcingReply = ((ownThreats | threats[side ^ 1]) & nextPlayable) != 0;
+        return {false, forcingReply, (int16_t)(side == 0 ? score : -score)};
+    }
+
+    // true if m makes or blocks a three in a line, judged by its heuristic delta.
+    // Moves that haven't been scored yet count as tactical. Tactical moves are never reduced.
+    bool isTactical(const connect3dMoveFast& m) const {
+        return !m.hasHeuristic || m.deltaHeuristic >= threeDelta;
+    }
+
+    // the cell a move in column m would land on
+    int moveCell(const connect3dMoveFast& m) const {
+        return m.movenum + (heights[m.movenum] << 4);
+    }
+
     int16_t heuristic() override {
         return (int16_t)currentScore;
     }
 
     uint64_t hash() const override {
-        uint64_t m = zHashes[0];
-        for(int i=1; i<8; ++i) if(zHashes[i] < m) m = zHashes[i];
-        return m;
+        return minHash(zHashes);
+    }
+
+    // the symmetry whose hash is the canonical one, the first if several are
+    int canonicalSymmetry() const {
+        uint64_t h = hash();
+        int s = 0;
+        while (zHashes[s] != h) ++s;
+        return s;
+    }
+
+    // a move as it is played in the canonical orientation, for storing under the canonical hash
+    uint8_t canonicalMove(const connect3dMoveFast& m) const {
+        return m.isValid() ? (uint8_t)symmetryTable[canonicalSymmetry()][m.movenum] : m.movenum;
+    }
+
+    // the move in this position's orientation of a move stored in the canonical orientation
+    connect3dMoveFast moveFromCanonical(uint8_t m) const {
+        return m < 16 ? connect3dMoveFast(inverseSymmetryTable[canonicalSymmetry()][m]) : connect3dMoveFast();
     }
 
+    // Symmetries of a bitboard. Each 16 bit layer is a 4x4 board with a row per nibble, and every
+    // symmetry of the cube that keeps gravity is a symmetry of the layers, so all four are moved at once.
+    static constexpr uint64_t mirrorColumns(uint64_t b) { // c -> 3 - c, reverses each nibble
+        return ((b & 0x1111111111111111ULL) << 3) | ((b & 0x8888888888888888ULL) >> 3)
+             | ((b & 0x2222222222222222ULL) << 1) | ((b & 0x4444444444444444ULL) >> 1);
+    }
+
+    static constexpr uint64_t mirrorRows(uint64_t b) { // r -> 3 - r, reverses the nibbles of each layer
+        return ((b & 0x000F000F000F000FULL) << 12) | ((b & 0xF000F000F000F000ULL) >> 12)
+             | ((b & 0x00F000F000F000F0ULL) << 4) | ((b & 0x0F000F000F000F00ULL) >> 4);
+    }
+
+    static constexpr uint64_t transposeLayers(uint64_t b) { // (r, c) -> (c, r), swaps 2x2 blocks then cells within them
+        uint64_t t = (b ^ (b >> 6)) & 0x00CC00CC00CC00CCULL;
+        b ^= t ^ (t << 6);
+        t = (b ^ (b >> 3)) & 0x0A0A0A0A0A0A0A0AULL;
+        return b ^ t ^ (t << 3);
+    }
+
+    // all 8 symmetries of a bitboard, sharing the intermediate transforms.
+    // In the s-th, bit i of b has moved to getSymmetryTable()[s][i].
+    static constexpr std::array<uint64_t, 8> symmetries(uint64_t b) {
+        uint64_t t = transposeLayers(b);
+        uint64_t c = mirrorColumns(b);
+        uint64_t ct = mirrorColumns(t);
+        return {b, ct, mirrorRows(c), mirrorRows(t), c, mirrorRows(b), t, mirrorRows(ct)};
+    }
+
+    static constexpr uint64_t applySymmetry(uint64_t b, int s) { return symmetries(b)[s]; }
+
 private:
-    void getColumnValues(std::array<uint8_t, 16>& vals) const {
+    // Packs a position into 80 bits, 5 per column. A column of height h is (2^h - 1) + its player A
+    // pieces as h bits, which gives each of the 31 possible columns its own code.
+    static std::array<uint8_t, 10> compress(uint64_t boardA, uint64_t boardB) {
+        uint64_t filled = boardA | boardB;
+        uint64_t lo = 0, hi = 0;
         for (int i = 0; i < 16; i++) {
-            uint8_t val = 0;
-            // L1 (Bottom)
-            if (boardA & (1ULL << i)) val += 1;
-            else if (boardB & (1ULL << i)) val += 16;
-            
-            // L2
-            if (boardA & (1ULL << (i+16))) val += 1;
-            else if (boardB & (1ULL << (i+16))) val += 8;
-
-            // L3
-            if (boardA & (1ULL << (i+32))) val += 1;
-            else if (boardB & (1ULL << (i+32))) val += 4;
-
-            // L4 (Top)
-            if (boardA & (1ULL << (i+48))) val += 1;
-            else if (boardB & (1ULL << (i+48))) val += 2;
-            
-            vals[i] = val;
+            uint64_t a = ((boardA >> i) & 1) | ((boardA >> (i + 15)) & 2) | ((boardA >> (i + 30)) & 4) | ((boardA >> (i + 45)) & 8);
+            uint64_t f = ((filled >> i) & 1) | ((filled >> (i + 15)) & 2) | ((filled >> (i + 30)) & 4) | ((filled >> (i + 45)) & 8);
+            uint64_t v = f + a;
+            if (i < 12) lo |= v << (5 * i);
+            else hi |= v << (5 * (i - 12));
         }
+        lo |= hi << 60;
+        hi >>= 4;
+
+        std::array<uint8_t, 10> compressed;
+        for (int i = 0; i < 8; i++) compressed[i] = (uint8_t)(lo >> (8 * i));
+        compressed[8] = (uint8_t)hi;
+        compressed[9] = (uint8_t)(hi >> 8);
+        return compressed;
     }
 
 public:
     std::array<uint8_t, 10> compressPositionNoRotation() const {
-        std::array<uint8_t, 16> vals;
-        getColumnValues(vals);
-        
-        std::array<uint8_t, 10> compressed;
-        compressed.fill(0);
-        int bitOffset = 0;
-        for (int i = 0; i < 16; i++) {
-            uint8_t v = vals[i];
-            int byteIdx = bitOffset / 8;
-            int bitInByte = bitOffset % 8;
-            compressed[byteIdx] |= (v << bitInByte);
-            if (bitInByte > 3) {
-                compressed[byteIdx + 1] |= (v >> (8 - bitInByte));
-            }
-            bitOffset += 5;
-        }
-        return compressed;
+        return compress(boardA, boardB);
     }
 
+    // The canonical orientation is the symmetry with the smallest (boardA, boardB) pair,
+    // so only that one is packed.
     std::array<uint8_t, 10> compressPosition() const override {
-
-        //return compressPositionNoRotation();
-        std::array<uint8_t, 16> vals;
-        getColumnValues(vals);
-        
-        std::array<uint8_t, 10> minCompressed;
-        minCompressed.fill(255);
-
-        const auto& symTable = getSymmetryTable();
-
-        for (int s = 0; s < 8; s++) {
-            std::array<uint8_t, 16> permutedVals;
-            for(int src=0; src<16; ++src) {
-                permutedVals[symTable[s][src]] = vals[src];
-            }
-
-            std::array<uint8_t, 10> currentCompressed;
-            currentCompressed.fill(0);
-            int bitOffset = 0;
-            for (int i = 0; i < 16; i++) {
-                uint8_t v = permutedVals[i];
-                int byteIdx = bitOffset / 8;
-                int bitInByte = bitOffset % 8;
-                currentCompressed[byteIdx] |= (v << bitInByte);
-                if (bitInByte > 3) {
-                    currentCompressed[byteIdx + 1] |= (v >> (8 - bitInByte));
-                }
-                bitOffset += 5;
-            }
-            
-            if (currentCompressed < minCompressed) {
-                minCompressed = currentCompressed;
-            }
+        auto symA = symmetries(boardA);
+        auto symB = symmetries(boardB);
+        unsigned __int128 minKey = ((unsigned __int128)symA[0] << 64) | symB[0];
+        for (int s = 1; s < 8; s++) {
+            unsigned __int128 key = ((unsigned __int128)symA[s] << 64) | symB[s];
+            minKey = key < minKey ? key : minKey;
         }
-        return minCompressed;
+        uint64_t minA = (uint64_t)(minKey >> 64), minB = (uint64_t)minKey;
+        return compress(minA, minB);
     }
 };
 }
@@ -547,21 +793,47 @@ public:
 
 class MinimaxAI_b5_v2 : public AI_base {
 public:
-    std::vector<mm5::TTEntry> tt;
-
-    MinimaxAI_b5_v2() {
-        tt.resize((1024 * 1024 * 4 + sizeof(mm5::TTEntry)) / sizeof(mm5::TTEntry)); // 4MB + 1 ttentry 
+    mm5::transpositionTable tt;
+
+    // search depth in half moves. With a time budget this is the deepest iteration allowed.
+    // Late move reductions make depth 8 about as fast as depth 7 without them.
+    int maxDepth;
+    // per move time budget in milliseconds. 0 searches straight to maxDepth with no time limit.
+    double moveTimeMs;
+    // search threads. More than 1 runs a lazy SMP search sharing tt.
+    unsigned threads;
+    mm5::searchOptions options;
+
+    // score of the previous move, the expected score for an aspiration window or MTD(f)
+    int16_t lastScore = 0;
+    bool hasLastScore = false;
+
+    MinimaxAI_b5_v2(int maxDepth = 8, double moveTimeMs = 0, unsigned threads = 1)
+        : maxDepth(maxDepth), moveTimeMs(moveTimeMs), threads(threads) {
+        tt.resize(1024 * 1024 * 4); // 4MB
     }
 
     evalReturn getNextMove(connect3dBoard board) override {
         b5_v2::connect3dBoardFast adapter(board);
         mm5::stat_t stats;
+        tt.newSearch();
         b5_v2::connect3dMoveFast bestMove;
-        
-        // Depth 5 provides a good balance of strength and speed for branching factor 16
-        int depth = 7; 
-
-        int16_t score = mm5::minimax(adapter, board.getPlayerTurn(), 0, depth, &bestMove, stats, tt);
+        int16_t score;
+
+        if (threads > 1) {
+            mm5::searchControl control;
+            if (moveTimeMs > 0) control.setTimeBudget(moveTimeMs);
+            score = mm5::lazySmp(adapter, board.getPlayerTurn(), maxDepth, lastScore, hasLastScore, &bestMove, stats, tt, threads, moveTimeMs > 0, &control, options);
+        } else if (moveTimeMs > 0) {
+            // deepen until the time budget runs out, keeping the last completed iteration
+            mm5::searchControl control;
+            control.setTimeBudget(moveTimeMs);
+            score = mm5::iterativeDeepening(adapter, board.getPlayerTurn(), maxDepth, &bestMove, stats, tt, &control, options);
+        } else {
+            score = mm5::searchRoot(adapter, board.getPlayerTurn(), maxDepth, lastScore, hasLastScore, &bestMove, stats, tt, nullptr, options);
+        }
+        lastScore = score;
+        hasLastScore = true;
         
         return {((double) score) / 16000.0, bestMove, stats.nodesExplored, stats.hashCollisions};
     }